@@ -0,0 +1,236 @@
+#include "append.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <limits>
+#include <system_error>
+
+#include <nlohmann/json.hpp>
+
+#include "gltf.h"
+#include "io.h"
+
+using json = nlohmann::json;
+
+bool appendToGltf(const std::string& filename, const std::string& binaryInput, std::uint32_t count, std::uint32_t degree, std::size_t maxBufferSize)
+{
+    const std::string text = loadFile(filename);
+
+    json glTF = json::parse(text, nullptr, false);
+    if (glTF.is_discarded() || !glTF.is_object())
+    {
+        printf("Error: Could not load glTF '%s'\n", filename.c_str());
+
+        return false;
+    }
+
+    //
+    // Locating the splats to extend.
+    //
+
+    // Split outputs have one primitive per buffer, of which the last one is extended.
+    if (!glTF.contains("meshes") || glTF["meshes"].empty() || !glTF["meshes"][0u].contains("primitives") || glTF["meshes"][0u]["primitives"].empty())
+    {
+        printf("Error: '%s' has no splats to append to\n", filename.c_str());
+
+        return false;
+    }
+
+    const json& primitive = glTF["meshes"][0u]["primitives"].back();
+    if (!primitive.contains("extensions") || !primitive["extensions"].contains("KHR_gaussian_splatting") || !primitive.contains("attributes") || !primitive["attributes"].contains("POSITION"))
+    {
+        printf("Error: '%s' has no splats to append to\n", filename.c_str());
+
+        return false;
+    }
+
+    // Texture atlases of --textures would keep their size and miss the appended splats.
+    if (primitive["extensions"].contains("EXT_gaussian_splatting_textures"))
+    {
+        printf("Error: Splats of '%s' are also stored as textures, which requires converting again\n", filename.c_str());
+
+        return false;
+    }
+
+    const std::size_t positionIndex = primitive["attributes"]["POSITION"].get<std::size_t>();
+    const std::size_t bufferViewIndex = glTF["accessors"][positionIndex]["bufferView"].get<std::size_t>();
+    const std::size_t previousCount = glTF["accessors"][positionIndex]["count"].get<std::size_t>();
+
+    json& bufferView = glTF["bufferViews"][bufferViewIndex];
+
+    const std::size_t bufferIndex = bufferView.value("buffer", std::size_t{0u});
+    json& buffer = glTF["buffers"][bufferIndex];
+
+    const std::size_t byteStride = bufferView.value("byteStride", std::size_t{0u});
+    const std::size_t byteOffset = bufferView.value("byteOffset", std::size_t{0u});
+    const std::size_t byteLength = bufferView["byteLength"].get<std::size_t>();
+    const std::size_t bufferByteLength = buffer["byteLength"].get<std::size_t>();
+
+    // Attributes in further bufferViews, e.g. the bands of --sh-bands in other meshes, would not be extended along.
+    for (const auto& mesh : glTF["meshes"])
+    {
+        const json primitives = mesh.value("primitives", json::array());
+        for (const auto& other : primitives)
+        {
+            const json attributes = other.value("attributes", json::object());
+
+            bool shared{false};
+            bool separate{false};
+            for (const auto& [name, accessor] : attributes.items())
+            {
+                const bool interleaved{glTF["accessors"][accessor.get<std::size_t>()].value("bufferView", std::numeric_limits<std::size_t>::max()) == bufferViewIndex};
+                shared = shared || interleaved;
+                separate = separate || !interleaved;
+            }
+
+            if (shared && separate)
+            {
+                printf("Error: Splats of '%s' are spread across several bufferViews, which requires converting again\n", filename.c_str());
+
+                return false;
+            }
+        }
+    }
+
+    std::uint32_t previousDegree{0u};
+    while (previousDegree < 3u && getByteStride(previousDegree) < byteStride)
+    {
+        previousDegree++;
+    }
+
+    if (byteStride != getByteStride(previousDegree))
+    {
+        printf("Error: Splats of '%s' are not interleaved records of this converter\n", filename.c_str());
+
+        return false;
+    }
+
+    std::string records{};
+    if (degree != previousDegree)
+    {
+        printf("Info: Changing spherical harmonics degree %u of the appended splats to %u\n", degree, previousDegree);
+
+        records = changeDegree(binaryInput, count, degree, previousDegree);
+    }
+    const std::string& binary = degree != previousDegree ? records : binaryInput;
+
+    // Appending in place requires the records to be the last data of the buffer, which is not the case with levels of detail.
+    if (byteLength != byteStride * previousCount || byteOffset + byteLength != bufferByteLength || !buffer.contains("uri"))
+    {
+        printf("Error: Splats of '%s' do not end their buffer\n", filename.c_str());
+
+        return false;
+    }
+
+    if (bufferByteLength + binary.size() > maxBufferSize || previousCount + count > std::numeric_limits<std::uint32_t>::max())
+    {
+        printf("Error: Appending exceeds the buffer size of '%s', which requires converting again\n", filename.c_str());
+
+        return false;
+    }
+
+    //
+    // Extending the buffer file.
+    //
+
+    const std::string bufferFilename = (std::filesystem::path(filename).parent_path() / buffer["uri"].get<std::string>()).generic_string();
+
+    // A different size means the buffer changed since the glTF was written, e.g. an interrupted append.
+    std::error_code errorCode{};
+    if (std::filesystem::file_size(bufferFilename, errorCode) != bufferByteLength || errorCode)
+    {
+        printf("Error: Size of '%s' does not match the glTF\n", bufferFilename.c_str());
+
+        return false;
+    }
+
+    // Appending in place would write through hardlinks, e.g. from the conversion cache, so a linked buffer is replaced by a copy first.
+    const std::uintmax_t links = std::filesystem::hard_link_count(bufferFilename, errorCode);
+    if (!errorCode && links > 1u)
+    {
+        const std::string copyFilename = bufferFilename + ".tmp";
+
+        std::filesystem::copy_file(bufferFilename, copyFilename, std::filesystem::copy_options::overwrite_existing, errorCode);
+        if (!errorCode)
+        {
+            std::filesystem::rename(copyFilename, bufferFilename, errorCode);
+        }
+
+        if (errorCode)
+        {
+            std::filesystem::remove(copyFilename, errorCode);
+
+            printf("Error: Could not copy '%s'\n", bufferFilename.c_str());
+
+            return false;
+        }
+    }
+    else if (errorCode)
+    {
+        printf("Error: Could not open '%s'\n", bufferFilename.c_str());
+
+        return false;
+    }
+
+    std::FILE* file = std::fopen(bufferFilename.c_str(), "ab");
+    if (!file)
+    {
+        printf("Error: Could not open '%s'\n", bufferFilename.c_str());
+
+        return false;
+    }
+
+    const bool written{std::fwrite(binary.data(), 1u, binary.size(), file) == binary.size()};
+    if (std::fclose(file) != 0 || !written)
+    {
+        printf("Error: Could not append to '%s'\n", bufferFilename.c_str());
+
+        return false;
+    }
+
+    printf("Info: Appended %u splats to '%s'\n", count, bufferFilename.c_str());
+
+    //
+    // Updating the glTF.
+    //
+
+    float minPosition[3];
+    float maxPosition[3];
+    getPositionBounds(binary, count, static_cast<std::uint32_t>(byteStride), minPosition, maxPosition);
+
+    for (auto& accessor : glTF["accessors"])
+    {
+        // Prefix accessors e.g. of progressive levels keep their count.
+        if (accessor.value("bufferView", std::numeric_limits<std::size_t>::max()) != bufferViewIndex || accessor["count"].get<std::size_t>() != previousCount)
+        {
+            continue;
+        }
+
+        accessor["count"] = previousCount + count;
+
+        if (accessor.contains("min") && accessor.contains("max"))
+        {
+            for (std::uint32_t i = 0u; i < 3u; i++)
+            {
+                accessor["min"][i] = std::min(accessor["min"][i].get<float>(), minPosition[i]);
+                accessor["max"][i] = std::max(accessor["max"][i].get<float>(), maxPosition[i]);
+            }
+        }
+    }
+
+    bufferView["byteLength"] = byteLength + binary.size();
+    buffer["byteLength"] = bufferByteLength + binary.size();
+
+    if (!saveFile(glTF.dump(3), filename))
+    {
+        printf("Error: Could not save '%s'\n", filename.c_str());
+
+        return false;
+    }
+
+    printf("Info: Saved '%s'\n", filename.c_str());
+
+    return true;
+}
@@ -0,0 +1,13 @@
+#ifndef GLTF_APPEND_H
+#define GLTF_APPEND_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Appends the interleaved records in binary to the splats of an existing glTF written by this converter. The records are
+// added to the end of the last buffer file in place and only count, byteLength and the POSITION bounds of the JSON are updated.
+// Spherical harmonics are padded or truncated to the degree of the existing splats, whose bufferView has to end its buffer.
+bool appendToGltf(const std::string& filename, const std::string& binary, std::uint32_t count, std::uint32_t degree, std::size_t maxBufferSize);
+
+#endif /*GLTF_APPEND_H*/
@@ -0,0 +1,173 @@
+#include "bands.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+#include "gltf.h"
+#include "io.h"
+#include "parallel.h"
+
+using json = nlohmann::json;
+
+std::string getShBandUri(const std::string& uri, std::uint32_t band)
+{
+    const std::filesystem::path path(uri);
+
+    return path.stem().generic_string() + "_sh" + std::to_string(band) + path.extension().generic_string();
+}
+
+json createShBandsGltf(const std::string& uri, const std::string& binary, std::uint32_t count, std::uint32_t degree, std::vector<std::string>& outputs)
+{
+    const std::uint32_t byteStride = getByteStride(degree);
+
+    // Part of the record per band, which follow each other in the record.
+    std::uint32_t bandByteOffsets[4u]{};
+    std::uint32_t bandByteStrides[4u]{};
+    for (std::uint32_t band = 0u; band <= degree; band++)
+    {
+        bandByteOffsets[band] = band == 0u ? 0u : getByteStride(band - 1u);
+        bandByteStrides[band] = getByteStride(band) - bandByteOffsets[band];
+    }
+
+    outputs.resize(degree + 1u);
+    for (std::uint32_t band = 0u; band <= degree; band++)
+    {
+        outputs[band].resize(static_cast<std::size_t>(bandByteStrides[band]) * count);
+    }
+
+    // Every record is read once and distributed to the buffers.
+    parallelFor(0u, count, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t vertex = begin; vertex < end; vertex++)
+        {
+            const char* record = binary.data() + byteStride * vertex;
+
+            for (std::uint32_t band = 0u; band <= degree; band++)
+            {
+                std::memcpy(outputs[band].data() + bandByteStrides[band] * vertex, record + bandByteOffsets[band], bandByteStrides[band]);
+            }
+        }
+    });
+
+    //
+
+    float minPosition[3];
+    float maxPosition[3];
+    getPositionBounds(binary, count, byteStride, minPosition, maxPosition);
+
+    json glTF = createGltf(uri, outputs[0u].size(), count, 0u, minPosition, maxPosition);
+
+    // Mesh of every degree adds the accessors of its band to the ones of the previous degree.
+    json primitive = glTF["meshes"][0u]["primitives"][0u];
+
+    for (std::uint32_t band = 1u; band <= degree; band++)
+    {
+        json buffer = json::object();
+        buffer["uri"] = getShBandUri(uri, band);
+        buffer["byteLength"] = outputs[band].size();
+
+        glTF["buffers"].push_back(buffer);
+
+        const std::size_t bufferViewIndex = glTF["bufferViews"].size();
+
+        json bufferView = json::object();
+        bufferView["buffer"] = band;
+        bufferView["byteLength"] = outputs[band].size();
+        bufferView["byteStride"] = bandByteStrides[band];
+        bufferView["target"] = 34962;
+
+        glTF["bufferViews"].push_back(bufferView);
+
+        for (std::uint32_t n = 0u; n < 1u + 2u * band; n++)
+        {
+            std::string name{"SH_DEGREE_" + std::to_string(band) + "_COEF_" + std::to_string(n)};
+
+            json accessor = json::object();
+            accessor["name"] = name;
+            accessor["bufferView"] = bufferViewIndex;
+            accessor["byteOffset"] = n * 3u * sizeof(float);
+            accessor["componentType"] = 5126;
+            accessor["count"] = count;
+            accessor["type"] = "VEC3";
+
+            primitive["attributes"]["KHR_gaussian_splatting:" + name] = glTF["accessors"].size();
+
+            glTF["accessors"].push_back(accessor);
+        }
+
+        json mesh = json::object();
+        mesh["primitives"] = json::array();
+        mesh["primitives"].push_back(primitive);
+
+        glTF["meshes"].push_back(mesh);
+    }
+
+    if (degree == 0u)
+    {
+        return glTF;
+    }
+
+    // Lower degrees are the lower levels of detail, as they need less data.
+    glTF["nodes"][0u]["mesh"] = degree;
+
+    json ids = json::array();
+    for (std::uint32_t lower = degree; lower-- > 0u;)
+    {
+        json node = json::object();
+        node["mesh"] = lower;
+
+        ids.push_back(glTF["nodes"].size());
+        glTF["nodes"].push_back(node);
+    }
+
+    glTF["extensionsUsed"].push_back("MSFT_lod");
+
+    glTF["nodes"][0u]["extensions"] = json::object();
+    glTF["nodes"][0u]["extensions"]["MSFT_lod"] = json::object();
+    glTF["nodes"][0u]["extensions"]["MSFT_lod"]["ids"] = ids;
+
+    return glTF;
+}
+
+bool saveShBandsGltf(const json& glTF, const std::vector<std::string>& buffers, std::size_t maxBufferSize, const std::string& outputDirectory, const std::string& savenameJson, std::vector<std::string>& outputs)
+{
+    for (std::size_t i = 0u; i < buffers.size(); i++)
+    {
+        if (buffers[i].size() > maxBufferSize)
+        {
+            printf("Error: Buffers of --sh-bands can not be split into buffers of at most %zu bytes\n", maxBufferSize);
+
+            return false;
+        }
+    }
+
+    for (std::size_t i = 0u; i < buffers.size(); i++)
+    {
+        const std::string savenameBuffer = (std::filesystem::path(outputDirectory) / glTF["buffers"][i]["uri"].get<std::string>()).generic_string();
+
+        if (!saveFile(buffers[i], savenameBuffer))
+        {
+            printf("Error: Could not save '%s'\n", savenameBuffer.c_str());
+
+            return false;
+        }
+
+        printf("Info: Saved '%s'\n", savenameBuffer.c_str());
+
+        if (i > 0u)
+        {
+            outputs.push_back(savenameBuffer);
+        }
+    }
+
+    if (!saveFile(glTF.dump(3), savenameJson))
+    {
+        printf("Error: Could not save '%s'\n", savenameJson.c_str());
+
+        return false;
+    }
+
+    printf("Info: Saved '%s'\n", savenameJson.c_str());
+
+    return true;
+}
@@ -0,0 +1,23 @@
+#ifndef GLTF_BANDS_H
+#define GLTF_BANDS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+// Name of the buffer of the given spherical harmonics band, e.g. 'some_3dgs_sh2.bin' for band 2.
+std::string getShBandUri(const std::string& uri, std::uint32_t band);
+
+// Creates the glTF storing the base attributes in the first buffer and the coefficients of every higher band in a buffer of their
+// own, so clients can fetch the base first and further bands lazily. Every degree has a mesh sharing the accessors of the lower
+// ones. The first node references the one of all bands and, using MSFT_lod, the ones of fewer bands. The records are split into
+// the buffer contents in outputs in a single pass.
+nlohmann::json createShBandsGltf(const std::string& uri, const std::string& binary, std::uint32_t count, std::uint32_t degree, std::vector<std::string>& outputs);
+
+// Saves the buffers of createShBandsGltf into the output directory, followed by the glTF. Additional buffers are added to outputs.
+bool saveShBandsGltf(const nlohmann::json& glTF, const std::vector<std::string>& buffers, std::size_t maxBufferSize, const std::string& outputDirectory, const std::string& savenameJson, std::vector<std::string>& outputs);
+
+#endif /*GLTF_BANDS_H*/
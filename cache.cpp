@@ -0,0 +1,169 @@
+#include "cache.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <random>
+
+#include <nlohmann/json.hpp>
+
+#include "hash.h"
+#include "io.h"
+
+using json = nlohmann::json;
+
+// Has to be increased, whenever the generated output changes for the same input and options.
+constexpr std::uint64_t cacheVersion{2u};
+
+std::string getCacheKey(const char* data, std::size_t size, const std::string& options)
+{
+    const std::uint64_t optionsHash = hashXXH64(options.data(), options.size(), cacheVersion);
+    const std::uint64_t dataHash = hashParallel(data, size, optionsHash);
+
+    char key[33u];
+    std::snprintf(key, sizeof(key), "%016" PRIx64 "%016" PRIx64, dataHash, optionsHash);
+
+    return key;
+}
+
+// Renames every string referencing a cached output, e.g. the uri of buffers, images and of the raw textures in extensions.
+static void renameUris(json& value, const std::map<std::string, std::string>& renames)
+{
+    if (value.is_string())
+    {
+        const auto rename = renames.find(value.get<std::string>());
+        if (rename != renames.end())
+        {
+            value = rename->second;
+        }
+    }
+    else if (value.is_structured())
+    {
+        for (auto& element : value)
+        {
+            renameUris(element, renames);
+        }
+    }
+}
+
+bool restoreFromCache(const std::string& cacheDirectory, const std::string& key, const std::string& outputDirectory, const std::string& stem)
+{
+    const std::filesystem::path entry = std::filesystem::path(cacheDirectory) / key;
+
+    json manifest = json::parse(loadFile((entry / "manifest.json").string()), nullptr, false);
+    if (manifest.is_discarded() || !manifest.contains("stem") || !manifest.contains("outputs"))
+    {
+        return false;
+    }
+
+    // Cached names are originating from the input file name, which can differ for the same content.
+    const std::string cachedStem = manifest["stem"].get<std::string>();
+
+    std::map<std::string, std::string> renames{};
+    for (const auto& output : manifest["outputs"])
+    {
+        const std::string name = output.get<std::string>();
+        if (!name.starts_with(cachedStem))
+        {
+            return false;
+        }
+
+        renames[name] = stem + name.substr(cachedStem.size());
+    }
+
+    for (const auto& [name, rename] : renames)
+    {
+        const std::filesystem::path source = entry / name;
+        const std::filesystem::path destination = std::filesystem::path(outputDirectory) / rename;
+
+        std::error_code errorCode{};
+        std::filesystem::remove_all(destination, errorCode);
+
+        if (destination.extension() == ".gltf")
+        {
+            json glTF = json::parse(loadFile(source.string()), nullptr, false);
+            if (glTF.is_discarded())
+            {
+                return false;
+            }
+
+            renameUris(glTF, renames);
+
+            if (!saveFile(glTF.dump(3), destination.string()))
+            {
+                return false;
+            }
+
+            continue;
+        }
+
+        // Hardlinks are not copying any data, however do not work across file systems.
+        std::filesystem::copy(source, destination, std::filesystem::copy_options::recursive | std::filesystem::copy_options::create_hard_links, errorCode);
+        if (errorCode)
+        {
+            errorCode.clear();
+            std::filesystem::remove_all(destination, errorCode);
+
+            std::filesystem::copy(source, destination, std::filesystem::copy_options::recursive, errorCode);
+            if (errorCode)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool storeInCache(const std::string& cacheDirectory, const std::string& key, const std::string& stem, const std::vector<std::string>& outputs)
+{
+    const std::filesystem::path entry = std::filesystem::path(cacheDirectory) / key;
+
+    // Entry is assembled in a temporary folder and renamed at the end, so concurrent conversions never see partial entries.
+    const std::filesystem::path temporary = std::filesystem::path(cacheDirectory) / (key + ".tmp" + std::to_string(std::random_device{}()));
+
+    std::error_code errorCode{};
+    std::filesystem::remove_all(temporary, errorCode);
+    std::filesystem::create_directories(temporary, errorCode);
+    if (errorCode)
+    {
+        return false;
+    }
+
+    json manifest = json::object();
+    manifest["stem"] = stem;
+    manifest["outputs"] = json::array();
+
+    for (const auto& output : outputs)
+    {
+        const std::string name = std::filesystem::path(output).filename().generic_string();
+
+        // Outputs are later hardlinked from the cache, so the cache needs its own copy.
+        std::filesystem::copy(output, temporary / name, std::filesystem::copy_options::recursive, errorCode);
+        if (errorCode)
+        {
+            std::filesystem::remove_all(temporary, errorCode);
+
+            return false;
+        }
+
+        manifest["outputs"].push_back(name);
+    }
+
+    if (!saveFile(manifest.dump(3), (temporary / "manifest.json").string()))
+    {
+        std::filesystem::remove_all(temporary, errorCode);
+
+        return false;
+    }
+
+    std::filesystem::rename(temporary, entry, errorCode);
+    if (errorCode)
+    {
+        // Another conversion stored the same entry in the meantime.
+        std::filesystem::remove_all(temporary, errorCode);
+    }
+
+    return true;
+}
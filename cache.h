@@ -0,0 +1,18 @@
+#ifndef GLTF_CACHE_H
+#define GLTF_CACHE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Key of a conversion result from the input data and the options affecting the output.
+std::string getCacheKey(const char* data, std::size_t size, const std::string& options);
+
+// Hardlinks or copies the cached outputs into the output directory, renamed to start with the given stem, and updates buffer uris in glTF outputs.
+// Returns false on a cache miss.
+bool restoreFromCache(const std::string& cacheDirectory, const std::string& key, const std::string& outputDirectory, const std::string& stem);
+
+// Copies the outputs, which can be files or directories all starting with the stem, into the cache.
+bool storeInCache(const std::string& cacheDirectory, const std::string& key, const std::string& stem, const std::vector<std::string>& outputs);
+
+#endif /*GLTF_CACHE_H*/
@@ -0,0 +1,500 @@
+#include "cleanup.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "gltf.h"
+#include "parallel.h"
+
+// Bits per axis of the Morton code.
+constexpr std::uint32_t mortonBits{21u};
+
+// Upper bound of the neighbors considered for the density.
+constexpr std::uint32_t maxNeighbors{64u};
+
+// Levels searched for the nearest neighbors of a splat, beyond which their distance is only known to be larger.
+constexpr std::uint32_t maxLevels{4u};
+
+// Floaters are further than this many standard deviations from the mean neighbor distance.
+constexpr double floaterDeviations{2.0};
+
+// Byte offsets in the interleaved record.
+constexpr std::uint32_t scaleByteOffset{(3u + 4u) * sizeof(float)};
+constexpr std::uint32_t opacityByteOffset{(3u + 4u + 3u) * sizeof(float)};
+
+// Copy of the position, so searching neighbors reads consecutive memory instead of scattered records.
+struct GridEntry
+{
+    std::uint64_t code{0u};
+    std::uint32_t index{0u};
+    float position[3]{};
+};
+
+// Splats sorted by the Morton code of their finest cell. Every cell of every coarser level, given by dropping
+// 3 * shift bits, is then a contiguous range, which is found by binary search.
+struct SpatialGrid
+{
+    float origin[3]{};
+    // Edge length of the finest cells.
+    float cellSize{1.0f};
+
+    std::vector<GridEntry> entries{};
+};
+
+static std::uint64_t expandBits(std::uint64_t value)
+{
+    value &= 0x1fffffu;
+    value = (value | value << 32u) & 0x1f00000000ffffull;
+    value = (value | value << 16u) & 0x1f0000ff0000ffull;
+    value = (value | value << 8u) & 0x100f00f00f00f00full;
+    value = (value | value << 4u) & 0x10c30c30c30c30c3ull;
+    value = (value | value << 2u) & 0x1249249249249249ull;
+
+    return value;
+}
+
+static std::uint64_t getMortonCode(const std::int32_t cell[3])
+{
+    return expandBits(static_cast<std::uint64_t>(cell[0u])) | expandBits(static_cast<std::uint64_t>(cell[1u])) << 1u | expandBits(static_cast<std::uint64_t>(cell[2u])) << 2u;
+}
+
+static const float* getPosition(const std::string& binary, std::uint32_t byteStride, std::size_t vertex)
+{
+    return reinterpret_cast<const float*>(binary.data() + static_cast<std::size_t>(byteStride) * vertex);
+}
+
+// Cell of the position at the given level.
+static void getCell(const SpatialGrid& grid, const float* position, std::uint32_t shift, std::int32_t cell[3])
+{
+    for (std::uint32_t axis = 0u; axis < 3u; axis++)
+    {
+        const float finest = std::clamp(std::floor((position[axis] - grid.origin[axis]) / grid.cellSize), 0.0f, static_cast<float>((1u << mortonBits) - 1u));
+
+        cell[axis] = static_cast<std::int32_t>(finest) >> shift;
+    }
+}
+
+static SpatialGrid buildGrid(const std::string& binary, std::uint32_t count, std::uint32_t byteStride, const float minPosition[3], float extent)
+{
+    SpatialGrid grid{};
+    std::copy_n(minPosition, 3u, grid.origin);
+    grid.cellSize = extent / static_cast<float>((1u << mortonBits) - 1u);
+
+    grid.entries.resize(count);
+    parallelFor(0u, count, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t vertex = begin; vertex < end; vertex++)
+        {
+            const float* position = getPosition(binary, byteStride, vertex);
+
+            std::int32_t cell[3];
+            getCell(grid, position, 0u, cell);
+
+            grid.entries[vertex] = GridEntry{getMortonCode(cell), static_cast<std::uint32_t>(vertex), {position[0u], position[1u], position[2u]}};
+        }
+    });
+
+    parallelSort(grid.entries, [](const GridEntry& a, const GridEntry& b) {
+        return a.code < b.code || (a.code == b.code && a.index < b.index);
+    });
+
+    return grid;
+}
+
+// Splats in the cell of the position at the given level.
+static std::size_t countInCell(const SpatialGrid& grid, const float* position, std::uint32_t shift)
+{
+    std::int32_t cell[3];
+    getCell(grid, position, shift, cell);
+
+    const std::uint64_t first{getMortonCode(cell) << (3u * shift)};
+    const std::uint64_t last{first + (std::uint64_t{1u} << (3u * shift))};
+
+    auto compare = [](const GridEntry& entry, std::uint64_t value) {
+        return entry.code < value;
+    };
+
+    return static_cast<std::size_t>(std::lower_bound(grid.entries.begin(), grid.entries.end(), last, compare) - std::lower_bound(grid.entries.begin(), grid.entries.end(), first, compare));
+}
+
+// Finest level, at which the cell of the position holds at least the given amount of splats. Dense regions are searched on
+// fine levels and sparse ones on coarse levels, so every search visits about the same amount of splats.
+static std::uint32_t findLevel(const SpatialGrid& grid, const float* position, std::size_t splats)
+{
+    // Count is increasing with coarser levels, as the cells are nested.
+    std::uint32_t lowShift{0u};
+    std::uint32_t highShift{mortonBits};
+    while (lowShift < highShift)
+    {
+        const std::uint32_t shift = (lowShift + highShift) / 2u;
+
+        if (countInCell(grid, position, shift) >= splats)
+        {
+            highShift = shift;
+        }
+        else
+        {
+            lowShift = shift + 1u;
+        }
+    }
+
+    return lowShift;
+}
+
+// Calls function(entry) for every splat in the block of 2x2x2 cells at the given level, which is centered closest to the position.
+// All splats closer than half the cell size are visited.
+template <typename Function>
+static void forEachNeighbor(const SpatialGrid& grid, const float* position, std::uint32_t shift, Function function)
+{
+    const std::int32_t limit{static_cast<std::int32_t>(((1u << mortonBits) - 1u) >> shift)};
+    const float cellSize{grid.cellSize * static_cast<float>(1u << shift)};
+
+    std::int32_t first[3];
+    getCell(grid, position, shift, first);
+
+    // Extending towards the nearer neighbor on each axis.
+    for (std::uint32_t axis = 0u; axis < 3u; axis++)
+    {
+        const float offset = (position[axis] - grid.origin[axis]) / cellSize - static_cast<float>(first[axis]);
+        if (offset < 0.5f)
+        {
+            first[axis]--;
+        }
+    }
+
+    std::int32_t cell[3];
+    for (cell[2u] = std::max(first[2u], 0); cell[2u] <= std::min(first[2u] + 1, limit); cell[2u]++)
+    {
+        for (cell[1u] = std::max(first[1u], 0); cell[1u] <= std::min(first[1u] + 1, limit); cell[1u]++)
+        {
+            for (cell[0u] = std::max(first[0u], 0); cell[0u] <= std::min(first[0u] + 1, limit); cell[0u]++)
+            {
+                // Range of the finest codes inside the cell.
+                const std::uint64_t code{getMortonCode(cell) << (3u * shift)};
+
+                auto it = std::lower_bound(grid.entries.begin(), grid.entries.end(), code, [](const GridEntry& entry, std::uint64_t value) {
+                    return entry.code < value;
+                });
+
+                for (; it != grid.entries.end() && (it->code >> (3u * shift)) == (code >> (3u * shift)); ++it)
+                {
+                    function(*it);
+                }
+            }
+        }
+    }
+}
+
+static float getSquaredDistance(const float* a, const float* b)
+{
+    const float x{a[0u] - b[0u]};
+    const float y{a[1u] - b[1u]};
+    const float z{a[2u] - b[2u]};
+
+    return x * x + y * y + z * z;
+}
+
+std::uint32_t cleanupSplats(std::string& binary, std::uint32_t count, std::uint32_t degree, float tolerance, std::uint32_t neighbors)
+{
+    const std::uint32_t byteStride = getByteStride(degree);
+
+    if (count == 0u)
+    {
+        return count;
+    }
+
+    float minPosition[3];
+    float maxPosition[3];
+    getPositionBounds(binary, count, byteStride, minPosition, maxPosition);
+
+    float extent{0.0f};
+    for (std::uint32_t i = 0u; i < 3u; i++)
+    {
+        extent = std::max(extent, maxPosition[i] - minPosition[i]);
+    }
+    if (extent <= 0.0f)
+    {
+        extent = 1.0f;
+    }
+
+    // Shared by both steps, each choosing its own level.
+    const SpatialGrid grid = buildGrid(binary, count, byteStride, minPosition, extent);
+
+    std::vector<std::uint8_t> removed(count, 0u);
+
+    // Opacity of the splats, which absorbed duplicates.
+    std::vector<float> opacities(count);
+    for (std::size_t vertex = 0u; vertex < count; vertex++)
+    {
+        opacities[vertex] = *reinterpret_cast<const float*>(binary.data() + static_cast<std::size_t>(byteStride) * vertex + opacityByteOffset);
+    }
+
+    //
+    // Duplicates
+    //
+
+    std::uint32_t duplicates{0u};
+
+    if (tolerance > 0.0f)
+    {
+        // Cells of at least twice the tolerance guarantee, that all duplicates are found.
+        std::uint32_t shift{0u};
+        while (shift < mortonBits && grid.cellSize * static_cast<float>(1u << shift) < 2.0f * tolerance)
+        {
+            shift++;
+        }
+
+        auto getImportance = [&](std::size_t vertex) {
+            const float* scale = reinterpret_cast<const float*>(binary.data() + static_cast<std::size_t>(byteStride) * vertex + scaleByteOffset);
+
+            return opacities[vertex] * scale[0u] * scale[1u] * scale[2u];
+        };
+
+        // Every splat is merged into the most important one within the tolerance, ties are resolved by index.
+        std::vector<std::uint32_t> targets(count);
+        // Duplicates are symmetric, so only splats having any can absorb others.
+        std::vector<std::uint8_t> duplicated(count, 0u);
+
+        parallelFor(0u, count, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t vertex = begin; vertex < end; vertex++)
+            {
+                const float* position = getPosition(binary, byteStride, vertex);
+
+                std::uint32_t target{static_cast<std::uint32_t>(vertex)};
+                float targetImportance = getImportance(vertex);
+
+                forEachNeighbor(grid, position, shift, [&](const GridEntry& entry) {
+                    if (getSquaredDistance(position, entry.position) > tolerance * tolerance)
+                    {
+                        return;
+                    }
+
+                    const std::uint32_t other{entry.index};
+                    if (other == vertex)
+                    {
+                        return;
+                    }
+
+                    duplicated[vertex] = 1u;
+
+                    const float importance = getImportance(other);
+                    if (importance > targetImportance || (importance == targetImportance && other < target))
+                    {
+                        target = other;
+                        targetImportance = importance;
+                    }
+                });
+
+                targets[vertex] = target;
+            }
+        });
+
+        // Coverage of the merged splats is kept by compositing their opacities. Chained duplicates are dropped.
+        std::vector<float> merged(opacities);
+
+        parallelFor(0u, count, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t vertex = begin; vertex < end; vertex++)
+            {
+                if (targets[vertex] != vertex)
+                {
+                    removed[vertex] = 1u;
+
+                    continue;
+                }
+
+                if (!duplicated[vertex])
+                {
+                    continue;
+                }
+
+                const float* position = getPosition(binary, byteStride, vertex);
+
+                float transparency{1.0f - opacities[vertex]};
+                forEachNeighbor(grid, position, shift, [&](const GridEntry& entry) {
+                    const std::uint32_t other{entry.index};
+
+                    if (other != vertex && targets[other] == vertex)
+                    {
+                        transparency *= 1.0f - opacities[other];
+                    }
+                });
+
+                merged[vertex] = std::clamp(1.0f - transparency, 0.0f, 1.0f);
+            }
+        });
+
+        opacities.swap(merged);
+
+        duplicates = static_cast<std::uint32_t>(std::count(removed.begin(), removed.end(), 1u));
+
+        printf("Info: Merged %u duplicate splats within %f\n", duplicates, tolerance);
+    }
+
+    //
+    // Floaters
+    //
+
+    std::uint32_t floaters{0u};
+
+    if (neighbors > 0u)
+    {
+        const std::uint32_t k = std::min(neighbors, maxNeighbors);
+
+        // Mean distance to the k nearest remaining splats.
+        std::vector<float> distances(count, 0.0f);
+
+        parallelFor(0u, count, [&](std::size_t begin, std::size_t end) {
+            float nearest[maxNeighbors];
+
+            for (std::size_t vertex = begin; vertex < end; vertex++)
+            {
+                if (removed[vertex])
+                {
+                    continue;
+                }
+
+                const float* position = getPosition(binary, byteStride, vertex);
+
+                // Cells holding the splat and its k neighbors, so the nearest neighbors are mostly found within the surrounding cells.
+                std::uint32_t shift = findLevel(grid, position, std::max(2u, (k + 1u) / 4u));
+
+                // Sorted squared distances.
+                std::uint32_t found{0u};
+                float cellSize{0.0f};
+
+                for (std::uint32_t level = 0u; level < maxLevels; level++, shift++)
+                {
+                    found = 0u;
+                    cellSize = grid.cellSize * static_cast<float>(1u << std::min(shift, mortonBits));
+
+                    forEachNeighbor(grid, position, std::min(shift, mortonBits), [&](const GridEntry& entry) {
+                        if (entry.index == vertex || removed[entry.index])
+                        {
+                            return;
+                        }
+
+                        const float distance = getSquaredDistance(position, entry.position);
+                        if (found == k && distance >= nearest[k - 1u])
+                        {
+                            return;
+                        }
+
+                        std::uint32_t i = std::min(found, k - 1u);
+                        for (; i > 0u && nearest[i - 1u] > distance; i--)
+                        {
+                            nearest[i] = nearest[i - 1u];
+                        }
+                        nearest[i] = distance;
+
+                        found = std::min(found + 1u, k);
+                    });
+
+                    // All splats within half a cell size are visited, otherwise the search is repeated with larger cells.
+                    if (found == k && 4.0f * nearest[k - 1u] <= cellSize * cellSize)
+                    {
+                        break;
+                    }
+                }
+
+                // Missing neighbors are at least beyond the searched cells.
+                const float beyond{0.5f * cellSize};
+
+                double sum{0.0};
+                for (std::uint32_t i = 0u; i < k; i++)
+                {
+                    sum += i < found ? std::sqrt(nearest[i]) : beyond;
+                }
+
+                distances[vertex] = static_cast<float>(sum / k);
+            }
+        });
+
+        double sum{0.0};
+        double squaredSum{0.0};
+        std::uint32_t remaining{0u};
+        for (std::size_t vertex = 0u; vertex < count; vertex++)
+        {
+            if (!removed[vertex])
+            {
+                sum += distances[vertex];
+                squaredSum += static_cast<double>(distances[vertex]) * distances[vertex];
+                remaining++;
+            }
+        }
+
+        if (remaining > 0u)
+        {
+            const double mean = sum / remaining;
+            const double deviation = std::sqrt(std::max(squaredSum / remaining - mean * mean, 0.0));
+            const double threshold{mean + floaterDeviations * deviation};
+
+            for (std::size_t vertex = 0u; vertex < count; vertex++)
+            {
+                if (!removed[vertex] && distances[vertex] > threshold)
+                {
+                    removed[vertex] = 1u;
+                    floaters++;
+                }
+            }
+
+            printf("Info: Removed %u floaters with a mean distance to %u neighbors above %f\n", floaters, k, threshold);
+        }
+    }
+
+    //
+    // Compaction
+    //
+
+    // Ranges are compacted on their own thread after their output offsets are known.
+    const std::size_t rangeCount = std::max<std::size_t>(std::min<std::size_t>(getThreadCount(), count / 4096u), 1u);
+
+    std::vector<std::size_t> offsets(rangeCount + 1u, 0u);
+    parallelFor(0u, rangeCount, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t range = begin; range < end; range++)
+        {
+            const std::size_t first{count * range / rangeCount};
+            const std::size_t last{count * (range + 1u) / rangeCount};
+
+            offsets[range + 1u] = static_cast<std::size_t>(std::count(removed.begin() + first, removed.begin() + last, 0u));
+        }
+    });
+    for (std::size_t range = 0u; range < rangeCount; range++)
+    {
+        offsets[range + 1u] += offsets[range];
+    }
+
+    const std::uint32_t remaining{static_cast<std::uint32_t>(offsets[rangeCount])};
+
+    std::string compacted(static_cast<std::size_t>(byteStride) * remaining, '\0');
+
+    parallelFor(0u, rangeCount, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t range = begin; range < end; range++)
+        {
+            std::size_t output{offsets[range]};
+
+            for (std::size_t vertex = count * range / rangeCount; vertex < count * (range + 1u) / rangeCount; vertex++)
+            {
+                if (removed[vertex])
+                {
+                    continue;
+                }
+
+                char* record = compacted.data() + static_cast<std::size_t>(byteStride) * output;
+
+                std::memcpy(record, binary.data() + static_cast<std::size_t>(byteStride) * vertex, byteStride);
+                std::memcpy(record + opacityByteOffset, &opacities[vertex], sizeof(float));
+
+                output++;
+            }
+        }
+    });
+
+    binary.swap(compacted);
+
+    printf("Info: Kept %u of %u splats\n", remaining, count);
+
+    return remaining;
+}
@@ -0,0 +1,13 @@
+#ifndef GLTF_CLEANUP_H
+#define GLTF_CLEANUP_H
+
+#include <cstdint>
+#include <string>
+
+// Removes training artefacts from the interleaved records and compacts binary in place. Returns the remaining amount of splats.
+// Splats closer than tolerance to a more important one are merged into it, accumulating their opacity. Floaters are splats whose
+// mean distance to their nearest neighbors exceeds the mean of all splats by more than twice the standard deviation.
+// A zero tolerance or zero neighbors disables the respective step.
+std::uint32_t cleanupSplats(std::string& binary, std::uint32_t count, std::uint32_t degree, float tolerance, std::uint32_t neighbors);
+
+#endif /*GLTF_CLEANUP_H*/
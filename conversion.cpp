@@ -0,0 +1,611 @@
+#include "conversion.h"
+
+#include <chrono>
+#include <filesystem>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "append.h"
+#include "bands.h"
+#include "cache.h"
+#include "cleanup.h"
+#include "decode.h"
+#include "input.h"
+#include "io.h"
+#include "dump.h"
+#include "gltf.h"
+#include "lod.h"
+#include "memory.h"
+#include "palette.h"
+#include "progressive.h"
+#include "ply.h"
+#include "precompute.h"
+#include "shard.h"
+#include "texture.h"
+#include "tile.h"
+
+using json = nlohmann::json;
+
+static double getMilliseconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool convertInput(const ConversionOptions& options, ConversionBuffers& buffers, ConversionStats& stats)
+{
+    const std::string& loadname{options.filename};
+
+    // Reading the PLY from stdin and writing a GLB to the output stream.
+    const bool pipe{loadname == "-"};
+
+    if (pipe && !options.outputStream)
+    {
+        printf("Error: Reading from stdin requires writing to stdout\n");
+
+        return false;
+    }
+
+    if (options.outputStream && (options.tiles > 0u || options.dump || options.compressedPly || !options.cacheDirectory.empty()))
+    {
+        printf("Error: --tiles, --dump, --compressed-ply and --cache can not be combined with stdin\n");
+
+        return false;
+    }
+
+    if (options.maxBufferSize == 0u)
+    {
+        printf("Error: --max-buffer-size has to be greater than zero\n");
+
+        return false;
+    }
+
+    if (options.shPalette > maxShPaletteSize)
+    {
+        printf("Error: --sh-palette is limited to %u entries\n", maxShPaletteSize);
+
+        return false;
+    }
+
+    if (options.shPalette > 0u && (options.tiles > 0u || options.lod > 0u))
+    {
+        printf("Error: --sh-palette can not be combined with --tiles or --lod\n");
+
+        return false;
+    }
+
+    if (!options.appendTarget.empty() && (options.tiles > 0u || options.lod > 0u || options.shPalette > 0u || options.importanceOrder || options.dump || options.compressedPly || !options.cacheDirectory.empty() || options.outputStream))
+    {
+        printf("Error: --append can only be combined with --convert and --max-buffer-size\n");
+
+        return false;
+    }
+
+    if (options.precompute && (options.tiles > 0u || !options.appendTarget.empty()))
+    {
+        printf("Error: --precompute can not be combined with --tiles or --append\n");
+
+        return false;
+    }
+
+    if (!options.textures.empty() && options.textures != "raw" && options.textures != "png")
+    {
+        printf("Error: --textures has to be raw or png\n");
+
+        return false;
+    }
+
+    if (!options.textures.empty() && (options.tiles > 0u || options.lod > 0u || options.shPalette > 0u || options.importanceOrder || !options.appendTarget.empty() || options.outputStream))
+    {
+        printf("Error: --textures can not be combined with --tiles, --lod, --sh-palette, --importance-order, --append or stdout\n");
+
+        return false;
+    }
+
+    if (options.shBands && (options.tiles > 0u || options.lod > 0u || options.shPalette > 0u || options.progressiveLevels > 0u || options.precompute || !options.textures.empty() || !options.appendTarget.empty() || options.outputStream))
+    {
+        printf("Error: --sh-bands can not be combined with --tiles, --lod, --sh-palette, --progressive, --precompute, --textures, --append or stdout\n");
+
+        return false;
+    }
+
+    if (options.progressiveLevels > 0u && (options.tiles > 0u || options.lod > 0u || options.shPalette > 0u))
+    {
+        printf("Error: --progressive can not be combined with --tiles, --lod or --sh-palette\n");
+
+        return false;
+    }
+
+    if (options.shardCount > 0u && (options.dump || options.compressedPly || options.tiles > 0u || options.lod > 0u || options.shPalette > 0u || options.shBands || options.dedupeTolerance > 0.0f || options.floaterNeighbors > 0u || options.importanceOrder || options.progressiveLevels > 0u || options.precompute || !options.textures.empty() || !options.appendTarget.empty() || !options.cacheDirectory.empty() || options.outputStream))
+    {
+        printf("Error: --shard and --merge-shards can only be combined with --convert and --max-buffer-size\n");
+
+        return false;
+    }
+
+    if (options.shardCount > 0u && !options.mergeShards && options.shardIndex >= options.shardCount)
+    {
+        printf("Error: --shard index has to be less than the number of shards\n");
+
+        return false;
+    }
+
+    const InputFormat inputFormat = getInputFormat(loadname);
+    if (!isInputFormatSupported(inputFormat))
+    {
+        printf("Error: Format of '%s' is not supported by this build\n", loadname.c_str());
+
+        return false;
+    }
+
+    std::filesystem::path loadpath(loadname);
+    auto stem = loadpath.stem().generic_string();
+    if (inputFormat == InputFormat::PLY_GZIP || inputFormat == InputFormat::PLY_ZSTD)
+    {
+        // Removes the remaining extension e.g. of 'some_3dgs.ply.zst'.
+        stem = std::filesystem::path(stem).stem().generic_string();
+    }
+
+    // Buffer uris are relative to the glTF, so only the saved files are prefixed by the directory.
+    const std::filesystem::path outputDirectory{options.outputDirectory};
+
+    //
+    // glTF to PLY
+    //
+
+    if (inputFormat == InputFormat::GLTF || inputFormat == InputFormat::GLB)
+    {
+        if (options.convert || options.dump || options.compressedPly || options.tiles > 0u || options.lod > 0u || options.shPalette > 0u || !options.cacheDirectory.empty() || options.outputStream)
+        {
+            printf("Error: glTF input is only decoded to PLY and can not be combined with other options\n");
+
+            return false;
+        }
+
+        const std::string savenamePly{(outputDirectory / (stem + "_decoded.ply")).generic_string()};
+
+        auto start = std::chrono::steady_clock::now();
+
+        printf("Info: Decoding '%s' ...\n", loadname.c_str());
+
+        if (!decodeGltf(loadname, savenamePly))
+        {
+            printf("Error: Can not process `%s` file\n", loadname.c_str());
+
+            return false;
+        }
+
+        printf("Info: Success\n");
+
+        stats.process = getMilliseconds(start);
+
+        return true;
+    }
+
+    //
+    // Sharded conversion
+    //
+
+    if (options.shardCount > 0u)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        if (options.mergeShards)
+        {
+            printf("Info: Merging %u shards of '%s' ...\n", options.shardCount, loadname.c_str());
+
+            if (!mergeShards(options.shardCount, options.maxBufferSize, options.outputDirectory, stem))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            // Byte ranges are only known for uncompressed PLY.
+            if (inputFormat != InputFormat::PLY)
+            {
+                printf("Error: --shard requires a binary PLY file\n");
+
+                return false;
+            }
+
+            if (!convertShard(loadname, options.shardIndex, options.shardCount, options.convert, options.outputDirectory, stem, buffers.input, buffers.binary))
+            {
+                return false;
+            }
+        }
+
+        printf("Info: Success\n");
+
+        stats.process = getMilliseconds(start);
+
+        return true;
+    }
+
+    std::string savenameJson{(outputDirectory / (stem + ".gltf")).generic_string()};
+    std::string savenameBinary{stem + ".bin"};
+
+    std::string savenameDump{(outputDirectory / (stem + "_dump.ply")).generic_string()};
+
+    std::string savenameCompressed{(outputDirectory / (stem + ".compressed.ply")).generic_string()};
+
+    std::string savenameTiles{(outputDirectory / (stem + "_tiles")).generic_string()};
+
+    // Outputs of this conversion, as stored in the cache. Additional buffers are added when splitting.
+    std::vector<std::string> outputs{};
+    if (options.tiles > 0u)
+    {
+        outputs.push_back(savenameTiles);
+    }
+    else
+    {
+        outputs.push_back(savenameJson);
+        outputs.push_back((outputDirectory / savenameBinary).generic_string());
+    }
+    if (options.dump)
+    {
+        outputs.push_back(savenameDump);
+    }
+    if (options.compressedPly)
+    {
+        outputs.push_back(savenameCompressed);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    //
+    // Conversion cache
+    //
+
+    // All options affecting the output are part of the cache key.
+    std::string cacheOptions{"convert=" + std::to_string(options.convert) + " dump=" + std::to_string(options.dump) + " tiles=" + std::to_string(options.tiles) + " lod=" + std::to_string(options.lod) + " sh-palette=" + std::to_string(options.shPalette) + " max-buffer-size=" + std::to_string(options.maxBufferSize) + " importance-order=" + std::to_string(options.importanceOrder) + " progressive=" + std::to_string(options.progressiveLevels) + " dedupe=" + std::to_string(options.dedupeTolerance) + " floaters=" + std::to_string(options.floaterNeighbors) + " precompute=" + std::to_string(options.precompute) + " textures=" + options.textures + " compressed-ply=" + std::to_string(options.compressedPly) + " sh-bands=" + std::to_string(options.shBands)};
+
+    std::string cacheKey{};
+    if (!options.cacheDirectory.empty())
+    {
+        MappedFile mappedFile{};
+        if (!mapFile(loadname, mappedFile))
+        {
+            printf("Error: Could not load '%s'\n", loadname.c_str());
+
+            return false;
+        }
+
+        cacheKey = getCacheKey(mappedFile.data, mappedFile.size, cacheOptions);
+
+        if (restoreFromCache(options.cacheDirectory, cacheKey, options.outputDirectory, stem))
+        {
+            printf("Info: Restored '%s' from cache entry '%s'\n", loadname.c_str(), cacheKey.c_str());
+
+            printf("Info: Success\n");
+
+            stats.load = getMilliseconds(start);
+
+            return true;
+        }
+
+        printf("Info: No cache entry '%s' for '%s'\n", cacheKey.c_str(), loadname.c_str());
+    }
+
+    //
+    // PLY loading
+    //
+
+    if (options.convert)
+    {
+        printf("Info: Converting from z-up right-handed to y-up right-handed coordinate system.\n");
+    }
+    else
+    {
+        printf("Info: No conversion and assuming y-up right-handed coordinate system.\n");
+    }
+
+    PlyHeader header{};
+
+    // glTF binary
+
+    std::string& binary{buffers.binary};
+
+    // The .bin is written while converting, if it only holds the splats in their original order.
+    const bool streamBinary{options.tiles == 0u && options.lod == 0u && options.shPalette == 0u && !options.shBands && !options.importanceOrder && options.progressiveLevels == 0u && options.dedupeTolerance == 0.0f && options.floaterNeighbors == 0u && !options.precompute && options.textures.empty() && options.appendTarget.empty() && !options.outputStream};
+    const std::string savenameStreamed{streamBinary ? (outputDirectory / savenameBinary).generic_string() : std::string{}};
+
+    printf("Info: Streaming '%s' ...\n", loadname.c_str());
+
+    binary.clear();
+
+    if (!streamInput(loadname, inputFormat, options.convert, savenameStreamed, options.maxBufferSize, header, binary, stats.pipeline))
+    {
+        printf("Error: Can not process `%s` file\n", loadname.c_str());
+
+        if (!savenameStreamed.empty())
+        {
+            std::error_code errorCode{};
+            std::filesystem::remove(savenameStreamed, errorCode);
+        }
+
+        return false;
+    }
+
+    printf("Info: Streamed '%s'\n", loadname.c_str());
+
+    stats.convertAllocations = stats.pipeline.convertAllocations;
+
+    std::uint32_t count{header.count};
+    const std::uint32_t l{header.degree};
+    const std::uint32_t byteStride = getByteStride(l);
+
+    // End of PLY specific code.
+
+    stats.load = getMilliseconds(start);
+    start = std::chrono::steady_clock::now();
+
+    if (options.dedupeTolerance > 0.0f || options.floaterNeighbors > 0u)
+    {
+        printf("Info: Removing duplicates and floaters\n");
+
+        count = cleanupSplats(binary, count, l, options.dedupeTolerance, options.floaterNeighbors);
+    }
+
+    if (!options.appendTarget.empty())
+    {
+        printf("Info: Appending %u splats to '%s'\n", count, options.appendTarget.c_str());
+
+        if (!appendToGltf(options.appendTarget, binary, count, l, options.maxBufferSize))
+        {
+            return false;
+        }
+
+        printf("Info: Success\n");
+
+        stats.save = getMilliseconds(start);
+
+        return true;
+    }
+
+    if (options.importanceOrder || options.progressiveLevels > 0u)
+    {
+        printf("Info: Sorting splats by importance\n");
+
+        sortByImportance(binary, count, l);
+    }
+
+    if (!options.textures.empty())
+    {
+        printf("Info: Sorting splats by Morton order\n");
+
+        sortByMortonOrder(binary, count, l);
+    }
+
+    if (options.tiles > 0u)
+    {
+        //
+        // Spatial tiling
+        //
+
+        printf("Info: Building octree with at most %u splats per tile\n", options.tiles);
+
+        Octree octree = buildOctree(binary, count, byteStride, options.tiles);
+
+        stats.process = getMilliseconds(start);
+        start = std::chrono::steady_clock::now();
+
+        if (!saveTiles(octree, binary, l, options.lod, savenameTiles))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        //
+        // Setup glTF
+        //
+
+        printf("Info: Setting up glTF\n");
+
+        json glTF{};
+
+        // Buffer content, in case it differs from the converted splats.
+        std::string& output{buffers.output};
+        output.clear();
+
+        // Buffer contents of --sh-bands, the base attributes followed by each higher band.
+        std::vector<std::string> bandBuffers{};
+
+        if (options.shPalette > 0u && l > 0u)
+        {
+            printf("Info: Clustering spherical harmonics into a palette of %u entries\n", options.shPalette);
+
+            ShPalette palette = buildShPalette(binary, count, l, options.shPalette);
+
+            glTF = createShPaletteGltf(savenameBinary, binary, count, l, palette, output);
+        }
+        else if (options.shBands)
+        {
+            printf("Info: Storing %u spherical harmonics bands in buffers of their own\n", l);
+
+            glTF = createShBandsGltf(savenameBinary, binary, count, l, bandBuffers);
+        }
+        else
+        {
+            glTF = createGltf(savenameBinary, binary, count, l);
+
+            if (options.lod > 0u)
+            {
+                printf("Info: Generating up to %u levels of detail\n", options.lod);
+
+                addLevelsOfDetail(glTF, binary, count, l, options.lod);
+            }
+            else if (options.progressiveLevels > 0u)
+            {
+                printf("Info: Adding up to %u progressive levels\n", options.progressiveLevels);
+
+                addProgressiveLevels(glTF, binary, count, options.progressiveLevels);
+            }
+        }
+
+        if (options.precompute)
+        {
+            printf("Info: Precomputing covariances and colors\n");
+
+            std::string& precomputed = output.empty() ? binary : output;
+
+            addPrecomputedAttributes(glTF, precomputed);
+
+            // Parts of the splats and their attributes would not line up.
+            if (precomputed.size() > options.maxBufferSize)
+            {
+                printf("Error: --precompute can not be split across buffers\n");
+
+                return false;
+            }
+        }
+
+        stats.process = getMilliseconds(start);
+        start = std::chrono::steady_clock::now();
+
+        //
+        // Storing to disk.
+        //
+
+        const std::string& buffer = output.empty() ? binary : output;
+
+        if (options.outputStream)
+        {
+            // Binary chunk of the GLB is the first buffer.
+            glTF["buffers"][0].erase("uri");
+
+            std::string glbHeader = createGlbHeader(glTF, buffer.size());
+            if (glbHeader.empty())
+            {
+                printf("Error: GLB output is limited to 4 GiB\n");
+
+                return false;
+            }
+
+            const std::string padding((4u - buffer.size() % 4u) % 4u, '\0');
+
+            if (!writeStream(glbHeader, options.outputStream) || !writeStream(buffer, options.outputStream) || !writeStream(padding, options.outputStream))
+            {
+                printf("Error: Could not write to stdout\n");
+
+                return false;
+            }
+
+            printf("Info: Written GLB to stdout\n");
+
+            printf("Info: Success\n");
+
+            stats.save = getMilliseconds(start);
+
+            return true;
+        }
+
+        if (!options.textures.empty())
+        {
+            printf("Info: Saving textures\n");
+
+            if (!saveTextures(glTF, binary, count, l, options.textures == "png", options.outputDirectory, stem, outputs))
+            {
+                return false;
+            }
+        }
+
+        if (!bandBuffers.empty())
+        {
+            if (!saveShBandsGltf(glTF, bandBuffers, options.maxBufferSize, options.outputDirectory, savenameJson, outputs))
+            {
+                return false;
+            }
+        }
+        else if (stats.pipeline.binaryWritten)
+        {
+            // Only the glTF is left, as the .bin has been written while converting.
+            if (!saveFile(glTF.dump(3), savenameJson))
+            {
+                printf("Error: Could not save '%s'\n", savenameJson.c_str());
+
+                return false;
+            }
+
+            printf("Info: Saved '%s'\n", savenameJson.c_str());
+        }
+        else if (!saveGltf(glTF, buffer, options.maxBufferSize, options.outputDirectory, savenameBinary, savenameJson, outputs))
+        {
+            return false;
+        }
+    }
+
+    printf("Info: Success\n");
+
+    if (options.dump)
+    {
+        std::string plyDump = dumpPly(binary, count, byteStride, l);
+
+        if (plyDump.empty())
+        {
+            printf("Error: Could not create PLY dump\n");
+
+            return false;
+        }
+
+        if (!saveFile(plyDump, savenameDump))
+        {
+            printf("Error: Could not save '%s'\n", savenameDump.c_str());
+
+            return false;
+        }
+
+        printf("Info: Saved '%s'\n", savenameDump.c_str());
+    }
+
+    if (options.compressedPly)
+    {
+        // Chunks of nearby splats have tighter bounds. All other outputs have been saved already.
+        sortByMortonOrder(binary, count, l);
+
+        std::string plyCompressed = compressPly(binary, count, byteStride, l);
+
+        if (!saveFile(plyCompressed, savenameCompressed))
+        {
+            printf("Error: Could not save '%s'\n", savenameCompressed.c_str());
+
+            return false;
+        }
+
+        printf("Info: Saved '%s'\n", savenameCompressed.c_str());
+    }
+
+    if (!options.cacheDirectory.empty())
+    {
+        if (!storeInCache(options.cacheDirectory, cacheKey, stem, outputs))
+        {
+            printf("Warning: Could not store cache entry '%s'\n", cacheKey.c_str());
+        }
+        else
+        {
+            printf("Info: Stored cache entry '%s'\n", cacheKey.c_str());
+        }
+    }
+
+    stats.save = getMilliseconds(start);
+
+    return true;
+}
+
+bool runConversion(const ConversionOptions& options, ConversionBuffers& buffers, ConversionStats& stats)
+{
+    stats = ConversionStats{};
+
+    const AllocationStats before = getAllocationStats();
+
+    const bool success = convertInput(options, buffers, stats);
+
+    const AllocationStats after = getAllocationStats();
+    stats.allocations = after.count - before.count;
+    stats.allocatedBytes = after.bytes - before.bytes;
+
+    return success;
+}
@@ -0,0 +1,78 @@
+#ifndef GLTF_CONVERSION_H
+#define GLTF_CONVERSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "pipeline.h"
+
+struct ConversionOptions
+{
+    // Input file, or '-' for stdin.
+    std::string filename{};
+    // Outputs are written to the current directory, if empty.
+    std::string outputDirectory{};
+    bool convert{false};
+    bool dump{false};
+    // Writes the PlayCanvas compressed PLY next to the glTF.
+    bool compressedPly{false};
+    std::uint32_t tiles{0u};
+    std::uint32_t lod{0u};
+    std::string cacheDirectory{};
+    std::uint32_t shPalette{0u};
+    // Stores the base attributes and every higher spherical harmonics band in a buffer of their own.
+    bool shBands{false};
+    // Merges splats closer than the tolerance and removes floaters by the distance to the given amount of neighbors.
+    float dedupeTolerance{0.0f};
+    std::uint32_t floaterNeighbors{0u};
+    // Sorts the splats by importance, with the given amount of prefix levels.
+    bool importanceOrder{false};
+    std::uint32_t progressiveLevels{0u};
+    // Adds the covariance and the base color, so viewers do not have to compute them.
+    bool precompute{false};
+    // Additionally stores the attributes as raw or png textures, if not empty.
+    std::string textures{};
+    // Larger buffers are failing to load in some browsers.
+    std::size_t maxBufferSize{std::size_t{1u} << 31u};
+    // Existing glTF the converted splats are appended to, instead of writing new outputs.
+    std::string appendTarget{};
+    // Converts only the shard with the given index of shardCount byte ranges into partial outputs, if shardCount is not zero.
+    std::uint32_t shardIndex{0u};
+    std::uint32_t shardCount{0u};
+    // Merges the partial outputs of all shardCount shards into the glTF, instead of converting.
+    bool mergeShards{false};
+    // Receives a GLB instead of writing files, required for stdin.
+    std::FILE* outputStream{nullptr};
+};
+
+// Memory kept across conversions, so its pages do not have to be faulted in again.
+struct ConversionBuffers
+{
+    std::string input{};
+    std::string binary{};
+    std::string output{};
+};
+
+struct ConversionStats
+{
+    // Duration of the conversion steps in milliseconds.
+    double load{0.0};
+    double process{0.0};
+    double save{0.0};
+
+    // Heap allocations of all threads during the conversion.
+    std::uint64_t allocations{0u};
+    std::uint64_t allocatedBytes{0u};
+    // Heap allocations while converting the PLY vertices, which is expected to be zero.
+    std::uint64_t convertAllocations{0u};
+
+    // Queue depths between the streaming stages.
+    PipelineStats pipeline{};
+};
+
+// Converts the input file into glTF or 3D Tiles outputs, as configured by the options. Messages are printed.
+bool runConversion(const ConversionOptions& options, ConversionBuffers& buffers, ConversionStats& stats);
+
+#endif /*GLTF_CONVERSION_H*/
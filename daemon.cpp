@@ -0,0 +1,477 @@
+#include "daemon.h"
+
+#include <cstdio>
+
+#include <nlohmann/json.hpp>
+
+#if !defined(_WIN32)
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using json = nlohmann::json;
+
+#if defined(_WIN32)
+
+bool runDaemon([[maybe_unused]] const std::string& socketPath, [[maybe_unused]] std::uint32_t workers)
+{
+    printf("Error: Daemon mode is not supported on this platform\n");
+
+    return false;
+}
+
+bool runClient([[maybe_unused]] const std::string& socketPath, [[maybe_unused]] const ConversionOptions& options)
+{
+    printf("Error: Daemon mode is not supported on this platform\n");
+
+    return false;
+}
+
+#else
+
+static bool createAddress(const std::string& socketPath, sockaddr_un& address)
+{
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    if (socketPath.size() >= sizeof(address.sun_path))
+    {
+        printf("Error: Socket path '%s' is too long\n", socketPath.c_str());
+
+        return false;
+    }
+
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+
+    return true;
+}
+
+static bool sendAll(int socket, const std::string& data)
+{
+    std::size_t offset{0u};
+    while (offset < data.size())
+    {
+        const ssize_t written = write(socket, data.data() + offset, data.size() - offset);
+        if (written <= 0)
+        {
+            return false;
+        }
+
+        offset += static_cast<std::size_t>(written);
+    }
+
+    return true;
+}
+
+// Reads up to the next newline. Returns false at the end of the stream.
+static bool receiveLine(int socket, std::string& pending, std::string& line)
+{
+    std::size_t newline{pending.find('\n')};
+    while (newline == std::string::npos)
+    {
+        char input[4096];
+
+        const ssize_t received = read(socket, input, sizeof(input));
+        if (received <= 0)
+        {
+            return false;
+        }
+
+        pending.append(input, static_cast<std::size_t>(received));
+
+        newline = pending.find('\n');
+    }
+
+    line = pending.substr(0u, newline);
+    pending.erase(0u, newline + 1u);
+
+    return true;
+}
+
+//
+// Daemon
+//
+
+static json getQueueStatus(const QueueMetrics& metrics)
+{
+    json status = json::object();
+    status["capacity"] = metrics.capacity;
+    status["items"] = metrics.items;
+    status["meanDepth"] = metrics.meanDepth;
+    status["maxDepth"] = metrics.maxDepth;
+    status["fullWaits"] = metrics.fullWaits;
+    status["emptyWaits"] = metrics.emptyWaits;
+
+    return status;
+}
+
+// Client connection, which is closed after the last status of its jobs has been sent.
+struct Connection
+{
+    int socket{-1};
+    std::mutex mutex{};
+
+    explicit Connection(int socket) : socket(socket)
+    {
+    }
+
+    ~Connection()
+    {
+        close(socket);
+    }
+
+    void send(const json& status)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // A client, which has gone away, does not stop the job.
+        sendAll(socket, status.dump() + "\n");
+    }
+};
+
+struct Job
+{
+    std::uint64_t id{0u};
+    ConversionOptions options{};
+    std::shared_ptr<Connection> connection{};
+    std::chrono::steady_clock::time_point queued{};
+};
+
+// Workers are started once and keep their conversion buffers across jobs.
+class WorkerPool
+{
+public:
+    explicit WorkerPool(std::uint32_t workers)
+    {
+        for (std::uint32_t i = 0u; i < workers; i++)
+        {
+            threads.emplace_back(&WorkerPool::work, this);
+        }
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopped = true;
+        }
+        condition.notify_all();
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    void push(Job job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+        }
+        condition.notify_one();
+    }
+
+private:
+    void work()
+    {
+        ConversionBuffers buffers{};
+
+        while (true)
+        {
+            Job job{};
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [&] {
+                    return stopped || !jobs.empty();
+                });
+
+                if (jobs.empty())
+                {
+                    return;
+                }
+
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+
+            const auto start = std::chrono::steady_clock::now();
+
+            ConversionStats stats{};
+            const bool success = runConversion(job.options, buffers, stats);
+
+            json status = json::object();
+            status["id"] = job.id;
+            status["filename"] = job.options.filename;
+            status["status"] = success ? "success" : "failed";
+            status["queueMilliseconds"] = std::chrono::duration<double, std::milli>(start - job.queued).count();
+            status["loadMilliseconds"] = stats.load;
+            status["processMilliseconds"] = stats.process;
+            status["saveMilliseconds"] = stats.save;
+            status["totalMilliseconds"] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            // Include allocations of concurrent jobs.
+            status["allocations"] = stats.allocations;
+            status["allocatedBytes"] = stats.allocatedBytes;
+            status["convertAllocations"] = stats.convertAllocations;
+            status["workers"] = stats.pipeline.workers;
+            status["steals"] = stats.pipeline.steals;
+            status["queues"] = json::object();
+            status["queues"]["read"] = getQueueStatus(stats.pipeline.read);
+            status["queues"]["convert"] = getQueueStatus(stats.pipeline.convert);
+            status["queues"]["write"] = getQueueStatus(stats.pipeline.write);
+
+            job.connection->send(status);
+        }
+    }
+
+    std::mutex mutex{};
+    std::condition_variable condition{};
+    std::deque<Job> jobs{};
+    bool stopped{false};
+    std::vector<std::thread> threads{};
+};
+
+static bool parseJob(const std::string& line, ConversionOptions& options)
+{
+    json request = json::parse(line, nullptr, false);
+    if (request.is_discarded() || !request.is_object() || !request.contains("filename") || !request["filename"].is_string())
+    {
+        return false;
+    }
+
+    try
+    {
+        options.filename = request["filename"].get<std::string>();
+        options.outputDirectory = request.value("outputDirectory", options.outputDirectory);
+        options.convert = request.value("convert", options.convert);
+        options.dump = request.value("dump", options.dump);
+        options.compressedPly = request.value("compressedPly", options.compressedPly);
+        options.tiles = request.value("tiles", options.tiles);
+        options.lod = request.value("lod", options.lod);
+        options.cacheDirectory = request.value("cache", options.cacheDirectory);
+        options.shPalette = request.value("shPalette", options.shPalette);
+        options.shBands = request.value("shBands", options.shBands);
+        options.maxBufferSize = request.value("maxBufferSize", options.maxBufferSize);
+        options.importanceOrder = request.value("importanceOrder", options.importanceOrder);
+        options.progressiveLevels = request.value("progressiveLevels", options.progressiveLevels);
+        options.appendTarget = request.value("append", options.appendTarget);
+        options.dedupeTolerance = request.value("dedupe", options.dedupeTolerance);
+        options.floaterNeighbors = request.value("floaters", options.floaterNeighbors);
+        options.precompute = request.value("precompute", options.precompute);
+        options.textures = request.value("textures", options.textures);
+        options.shardIndex = request.value("shardIndex", options.shardIndex);
+        options.shardCount = request.value("shardCount", options.shardCount);
+        options.mergeShards = request.value("mergeShards", options.mergeShards);
+    }
+    catch (const json::exception&)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+static void serveConnection(std::shared_ptr<Connection> connection, WorkerPool& workerPool, std::atomic<std::uint64_t>& nextId)
+{
+    std::string pending{};
+    std::string line{};
+    while (receiveLine(connection->socket, pending, line))
+    {
+        if (line.empty())
+        {
+            continue;
+        }
+
+        const std::uint64_t id = nextId++;
+
+        Job job{};
+        if (!parseJob(line, job.options))
+        {
+            json status = json::object();
+            status["id"] = id;
+            status["status"] = "failed";
+            status["error"] = "Invalid job";
+
+            connection->send(status);
+
+            continue;
+        }
+
+        job.id = id;
+        job.connection = connection;
+        job.queued = std::chrono::steady_clock::now();
+
+        json status = json::object();
+        status["id"] = id;
+        status["filename"] = job.options.filename;
+        status["status"] = "queued";
+
+        connection->send(status);
+
+        workerPool.push(std::move(job));
+    }
+}
+
+bool runDaemon([[maybe_unused]] const std::string& socketPath, [[maybe_unused]] std::uint32_t workers)
+{
+    sockaddr_un address{};
+    if (!createAddress(socketPath, address))
+    {
+        return false;
+    }
+
+    // Messages of concurrent jobs are interleaved, so each line is written immediately.
+    std::setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    // Writing to a client, which has disconnected, must not terminate the daemon.
+    std::signal(SIGPIPE, SIG_IGN);
+
+    const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0)
+    {
+        printf("Error: Could not create socket\n");
+
+        return false;
+    }
+
+    // Socket file of a previous daemon, which has not been shut down cleanly.
+    unlink(socketPath.c_str());
+
+    if (bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 64) != 0)
+    {
+        printf("Error: Could not listen on '%s'\n", socketPath.c_str());
+
+        close(listener);
+
+        return false;
+    }
+
+    WorkerPool workerPool{workers};
+    std::atomic<std::uint64_t> nextId{0u};
+
+    printf("Info: Listening on '%s' with %u workers\n", socketPath.c_str(), workers);
+
+    while (true)
+    {
+        const int client = accept(listener, nullptr, nullptr);
+        if (client < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            printf("Error: Could not accept connection\n");
+
+            break;
+        }
+
+        std::thread(serveConnection, std::make_shared<Connection>(client), std::ref(workerPool), std::ref(nextId)).detach();
+    }
+
+    close(listener);
+    unlink(socketPath.c_str());
+
+    return false;
+}
+
+//
+// Client
+//
+
+bool runClient([[maybe_unused]] const std::string& socketPath, [[maybe_unused]] const ConversionOptions& options)
+{
+    sockaddr_un address{};
+    if (!createAddress(socketPath, address))
+    {
+        return false;
+    }
+
+    const int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (connection < 0 || connect(connection, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        printf("Error: Could not connect to '%s'\n", socketPath.c_str());
+
+        if (connection >= 0)
+        {
+            close(connection);
+        }
+
+        return false;
+    }
+
+    // The daemon has a different working directory, so all paths are absolute.
+    json request = json::object();
+    request["filename"] = std::filesystem::absolute(options.filename).generic_string();
+    request["outputDirectory"] = std::filesystem::absolute(options.outputDirectory.empty() ? std::filesystem::current_path() : std::filesystem::path(options.outputDirectory)).generic_string();
+    request["convert"] = options.convert;
+    request["dump"] = options.dump;
+    request["compressedPly"] = options.compressedPly;
+    request["tiles"] = options.tiles;
+    request["lod"] = options.lod;
+    if (!options.cacheDirectory.empty())
+    {
+        request["cache"] = std::filesystem::absolute(options.cacheDirectory).generic_string();
+    }
+    request["shPalette"] = options.shPalette;
+    request["shBands"] = options.shBands;
+    request["maxBufferSize"] = options.maxBufferSize;
+    request["importanceOrder"] = options.importanceOrder;
+    request["progressiveLevels"] = options.progressiveLevels;
+    request["dedupe"] = options.dedupeTolerance;
+    request["floaters"] = options.floaterNeighbors;
+    request["precompute"] = options.precompute;
+    request["textures"] = options.textures;
+    request["shardIndex"] = options.shardIndex;
+    request["shardCount"] = options.shardCount;
+    request["mergeShards"] = options.mergeShards;
+    if (!options.appendTarget.empty())
+    {
+        request["append"] = std::filesystem::absolute(options.appendTarget).generic_string();
+    }
+
+    // Closing the sending side tells the daemon, that there are no further jobs on this connection.
+    if (!sendAll(connection, request.dump() + "\n") || shutdown(connection, SHUT_WR) != 0)
+    {
+        printf("Error: Could not send job to '%s'\n", socketPath.c_str());
+
+        close(connection);
+
+        return false;
+    }
+
+    bool success{false};
+
+    std::string pending{};
+    std::string line{};
+    while (receiveLine(connection, pending, line))
+    {
+        printf("%s\n", line.c_str());
+
+        json status = json::parse(line, nullptr, false);
+        if (!status.is_discarded() && status.value("status", "") == "success")
+        {
+            success = true;
+        }
+    }
+
+    close(connection);
+
+    return success;
+}
+
+#endif
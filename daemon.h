@@ -0,0 +1,16 @@
+#ifndef GLTF_DAEMON_H
+#define GLTF_DAEMON_H
+
+#include <cstdint>
+#include <string>
+
+#include "conversion.h"
+
+// Accepts conversion jobs as JSON lines on a Unix domain socket and runs them on a persistent pool of workers.
+// Every job is answered by a queued and a final status line including timings and allocation counters. Returns only on failure.
+bool runDaemon(const std::string& socketPath, std::uint32_t workers);
+
+// Sends the conversion job to the daemon and prints its status lines. Returns true, if the conversion succeeded.
+bool runClient(const std::string& socketPath, const ConversionOptions& options);
+
+#endif /*GLTF_DAEMON_H*/
@@ -0,0 +1,1011 @@
+#include "decode.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "io.h"
+#include "parallel.h"
+
+using json = nlohmann::json;
+
+// Splats decoded at once per thread, which bounds the scratch memory.
+constexpr std::size_t blockSize{4096u};
+
+// Highest supported spherical harmonics degree and its number of coefficients per channel.
+constexpr std::uint32_t maxDegree{3u};
+constexpr std::uint32_t maxCoefficients{3u + 5u + 7u};
+
+// Normalization of a degree 0 coefficient, required to decode COLOR_0.
+constexpr float shC0{0.28209479177387814f};
+
+//
+// Accessor decoding
+//
+
+// Element access to an accessor, which is pointing into a mapped buffer or, if sparse, into the materialized storage.
+struct AccessorReader
+{
+    const char* data{nullptr};
+    std::size_t byteStride{0u};
+    std::size_t count{0u};
+    std::uint32_t componentType{5126u};
+    std::uint32_t components{0u};
+    bool normalized{false};
+
+    std::vector<float> storage{};
+};
+
+template <typename T>
+static float decodeComponent(const char* data, bool normalized)
+{
+    // Copying, as interleaved data is not required to be aligned for T.
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+
+    if constexpr (std::is_floating_point_v<T>)
+    {
+        return value;
+    }
+    else
+    {
+        if (!normalized)
+        {
+            return static_cast<float>(value);
+        }
+
+        // Normalization as defined by the glTF specification.
+        const float normalizedValue = static_cast<float>(value) / static_cast<float>(std::numeric_limits<T>::max());
+        if constexpr (std::is_signed_v<T>)
+        {
+            return std::max(normalizedValue, -1.0f);
+        }
+
+        return normalizedValue;
+    }
+}
+
+template <typename T>
+static void readElements(const AccessorReader& reader, std::size_t begin, std::size_t end, float* output)
+{
+    for (std::size_t element = begin; element < end; element++)
+    {
+        const char* data = reader.data + reader.byteStride * element;
+
+        for (std::uint32_t component = 0u; component < reader.components; component++)
+        {
+            *output++ = decodeComponent<T>(data + component * sizeof(T), reader.normalized);
+        }
+    }
+}
+
+// Decodes the elements [begin, end) as tightly packed floats.
+static void readAccessor(const AccessorReader& reader, std::size_t begin, std::size_t end, float* output)
+{
+    switch (reader.componentType)
+    {
+        case 5120u:
+            readElements<std::int8_t>(reader, begin, end, output);
+            break;
+        case 5121u:
+            readElements<std::uint8_t>(reader, begin, end, output);
+            break;
+        case 5122u:
+            readElements<std::int16_t>(reader, begin, end, output);
+            break;
+        case 5123u:
+            readElements<std::uint16_t>(reader, begin, end, output);
+            break;
+        case 5125u:
+            readElements<std::uint32_t>(reader, begin, end, output);
+            break;
+        default:
+            readElements<float>(reader, begin, end, output);
+            break;
+    }
+}
+
+static std::uint32_t getComponentSize(std::uint32_t componentType)
+{
+    switch (componentType)
+    {
+        case 5120u:
+        case 5121u:
+            return 1u;
+        case 5122u:
+        case 5123u:
+            return 2u;
+        case 5125u:
+        case 5126u:
+            return 4u;
+        default:
+            return 0u;
+    }
+}
+
+static std::uint32_t getComponentCount(const std::string& type)
+{
+    if (type == "SCALAR")
+    {
+        return 1u;
+    }
+    else if (type == "VEC2")
+    {
+        return 2u;
+    }
+    else if (type == "VEC3")
+    {
+        return 3u;
+    }
+    else if (type == "VEC4")
+    {
+        return 4u;
+    }
+
+    return 0u;
+}
+
+//
+// Asset loading
+//
+
+struct GltfAsset
+{
+    json glTF{};
+
+    // Data of each buffer, either mapped or decoded from a data uri.
+    std::vector<std::string_view> buffers{};
+
+    std::vector<std::unique_ptr<MappedFile>> mappedFiles{};
+    std::vector<std::string> decodedBuffers{};
+};
+
+static bool decodeBase64(std::string_view input, std::string& output)
+{
+    std::uint32_t value{0u};
+    std::int32_t bits{-8};
+    for (char c : input)
+    {
+        std::int32_t digit{-1};
+        if (c >= 'A' && c <= 'Z')
+        {
+            digit = c - 'A';
+        }
+        else if (c >= 'a' && c <= 'z')
+        {
+            digit = c - 'a' + 26;
+        }
+        else if (c >= '0' && c <= '9')
+        {
+            digit = c - '0' + 52;
+        }
+        else if (c == '+')
+        {
+            digit = 62;
+        }
+        else if (c == '/')
+        {
+            digit = 63;
+        }
+        else if (c == '=')
+        {
+            break;
+        }
+        else
+        {
+            return false;
+        }
+
+        value = (value << 6u) | static_cast<std::uint32_t>(digit);
+        bits += 6;
+        if (bits >= 0)
+        {
+            output.push_back(static_cast<char>((value >> bits) & 0xFFu));
+            bits -= 8;
+        }
+    }
+
+    return true;
+}
+
+static bool loadAsset(const std::string& filename, GltfAsset& asset)
+{
+    const std::filesystem::path path(filename);
+
+    // Binary chunk of a GLB, which is referenced by the first buffer without uri.
+    std::string_view binaryChunk{};
+
+    auto mappedFile = std::make_unique<MappedFile>();
+    if (!mapFile(filename, *mappedFile))
+    {
+        printf("Error: Could not load '%s'\n", filename.c_str());
+
+        return false;
+    }
+
+    const char* data = mappedFile->data;
+    const std::size_t size{mappedFile->size};
+
+    std::uint32_t magic{0u};
+    if (size >= 4u)
+    {
+        std::memcpy(&magic, data, sizeof(magic));
+    }
+
+    if (magic == 0x46546C67u)
+    {
+        std::uint32_t header[5u]{};
+        if (size < sizeof(header))
+        {
+            printf("Error: GLB header of '%s' is truncated\n", filename.c_str());
+
+            return false;
+        }
+        std::memcpy(header, data, sizeof(header));
+
+        // Chunks are the JSON chunk followed by an optional binary chunk.
+        const std::size_t jsonLength{header[3u]};
+        if (header[4u] != 0x4E4F534Au || 20u + jsonLength > size)
+        {
+            printf("Error: Invalid GLB '%s'\n", filename.c_str());
+
+            return false;
+        }
+
+        asset.glTF = json::parse(data + 20u, data + 20u + jsonLength, nullptr, false);
+
+        const std::size_t binaryOffset{20u + jsonLength};
+        if (binaryOffset + 8u <= size)
+        {
+            std::uint32_t chunkHeader[2u]{};
+            std::memcpy(chunkHeader, data + binaryOffset, sizeof(chunkHeader));
+
+            if (chunkHeader[1u] == 0x004E4942u && binaryOffset + 8u + chunkHeader[0u] <= size)
+            {
+                binaryChunk = std::string_view(data + binaryOffset + 8u, chunkHeader[0u]);
+            }
+        }
+
+        asset.mappedFiles.push_back(std::move(mappedFile));
+    }
+    else
+    {
+        asset.glTF = json::parse(data, data + size, nullptr, false);
+    }
+
+    if (asset.glTF.is_discarded() || !asset.glTF.is_object())
+    {
+        printf("Error: Invalid glTF JSON in '%s'\n", filename.c_str());
+
+        return false;
+    }
+
+    if (!asset.glTF.contains("buffers"))
+    {
+        return true;
+    }
+
+    // Decoded data uris must not move after taking views.
+    asset.decodedBuffers.reserve(asset.glTF["buffers"].size());
+
+    for (const auto& buffer : asset.glTF["buffers"])
+    {
+        const std::size_t byteLength = buffer.value("byteLength", std::size_t{0u});
+
+        std::string_view bufferData{};
+
+        if (!buffer.contains("uri"))
+        {
+            bufferData = binaryChunk;
+        }
+        else
+        {
+            const std::string uri = buffer["uri"].get<std::string>();
+
+            if (uri.starts_with("data:"))
+            {
+                const std::size_t comma = uri.find(',');
+
+                std::string decoded{};
+                if (comma == std::string::npos || uri.find(";base64") > comma || !decodeBase64(std::string_view(uri).substr(comma + 1u), decoded))
+                {
+                    printf("Error: Unsupported data uri in '%s'\n", filename.c_str());
+
+                    return false;
+                }
+
+                asset.decodedBuffers.push_back(std::move(decoded));
+                bufferData = asset.decodedBuffers.back();
+            }
+            else
+            {
+                // Relative uris can be percent encoded, however this is not the case for the typical file names.
+                const std::string bufferFilename = (path.parent_path() / uri).string();
+
+                auto bufferFile = std::make_unique<MappedFile>();
+                if (!mapFile(bufferFilename, *bufferFile))
+                {
+                    printf("Error: Could not load '%s'\n", bufferFilename.c_str());
+
+                    return false;
+                }
+
+                bufferData = std::string_view(bufferFile->data, bufferFile->size);
+
+                asset.mappedFiles.push_back(std::move(bufferFile));
+            }
+        }
+
+        if (bufferData.size() < byteLength)
+        {
+            printf("Error: Buffer of '%s' is smaller than its byteLength\n", filename.c_str());
+
+            return false;
+        }
+
+        asset.buffers.push_back(bufferData.substr(0u, byteLength));
+    }
+
+    return true;
+}
+
+// Sets up reading of an accessor including validation of all ranges. Sparse accessors are materialized.
+static bool createReader(const GltfAsset& asset, std::size_t accessorIndex, std::uint32_t minComponents, AccessorReader& reader)
+{
+    const json& glTF = asset.glTF;
+
+    if (!glTF.contains("accessors") || accessorIndex >= glTF["accessors"].size())
+    {
+        return false;
+    }
+
+    const json& accessor = glTF["accessors"][accessorIndex];
+
+    reader.count = accessor.value("count", std::size_t{0u});
+    reader.componentType = accessor.value("componentType", 0u);
+    reader.components = getComponentCount(accessor.value("type", ""));
+    reader.normalized = accessor.value("normalized", false);
+
+    const std::uint32_t componentSize = getComponentSize(reader.componentType);
+    if (componentSize == 0u || reader.components < minComponents)
+    {
+        return false;
+    }
+
+    const std::size_t elementSize{static_cast<std::size_t>(componentSize) * reader.components};
+
+    if (accessor.contains("bufferView"))
+    {
+        const std::size_t bufferViewIndex = accessor["bufferView"].get<std::size_t>();
+        if (!glTF.contains("bufferViews") || bufferViewIndex >= glTF["bufferViews"].size())
+        {
+            return false;
+        }
+
+        const json& bufferView = glTF["bufferViews"][bufferViewIndex];
+
+        const std::size_t bufferIndex = bufferView.value("buffer", std::size_t{0u});
+        if (bufferIndex >= asset.buffers.size())
+        {
+            return false;
+        }
+
+        const std::string_view buffer = asset.buffers[bufferIndex];
+
+        const std::size_t bufferViewByteOffset = bufferView.value("byteOffset", std::size_t{0u});
+        const std::size_t bufferViewByteLength = bufferView.value("byteLength", std::size_t{0u});
+        if (bufferViewByteOffset + bufferViewByteLength > buffer.size())
+        {
+            return false;
+        }
+
+        const std::size_t byteOffset = accessor.value("byteOffset", std::size_t{0u});
+
+        reader.byteStride = bufferView.value("byteStride", elementSize);
+        if (reader.count > 0u && byteOffset + reader.byteStride * (reader.count - 1u) + elementSize > bufferViewByteLength)
+        {
+            return false;
+        }
+
+        reader.data = buffer.data() + bufferViewByteOffset + byteOffset;
+    }
+
+    if (!accessor.contains("sparse") && reader.data)
+    {
+        return true;
+    }
+
+    // Accessors without bufferView are initialized with zeros.
+    reader.storage.assign(reader.count * reader.components, 0.0f);
+    if (reader.data)
+    {
+        readAccessor(reader, 0u, reader.count, reader.storage.data());
+    }
+
+    if (accessor.contains("sparse"))
+    {
+        const json& sparse = accessor["sparse"];
+
+        const std::size_t sparseCount = sparse.value("count", std::size_t{0u});
+
+        // Indices and values are tightly packed sub accessors.
+        auto createSparseReader = [&](const json& source, std::uint32_t componentType, std::uint32_t components, AccessorReader& sparseReader) {
+            const std::size_t bufferViewIndex = source.value("bufferView", std::size_t{0u});
+            if (!glTF.contains("bufferViews") || bufferViewIndex >= glTF["bufferViews"].size())
+            {
+                return false;
+            }
+
+            const json& bufferView = glTF["bufferViews"][bufferViewIndex];
+
+            const std::size_t bufferIndex = bufferView.value("buffer", std::size_t{0u});
+            if (bufferIndex >= asset.buffers.size())
+            {
+                return false;
+            }
+
+            const std::size_t byteOffset = bufferView.value("byteOffset", std::size_t{0u}) + source.value("byteOffset", std::size_t{0u});
+
+            sparseReader.componentType = componentType;
+            sparseReader.components = components;
+            sparseReader.normalized = reader.normalized;
+            sparseReader.count = sparseCount;
+            sparseReader.byteStride = static_cast<std::size_t>(getComponentSize(componentType)) * components;
+
+            if (sparseReader.byteStride == 0u || byteOffset + sparseReader.byteStride * sparseCount > asset.buffers[bufferIndex].size())
+            {
+                return false;
+            }
+
+            sparseReader.data = asset.buffers[bufferIndex].data() + byteOffset;
+
+            return true;
+        };
+
+        AccessorReader indicesReader{};
+        AccessorReader valuesReader{};
+        if (!sparse.contains("indices") || !sparse.contains("values") ||
+            !createSparseReader(sparse["indices"], sparse["indices"].value("componentType", 0u), 1u, indicesReader) ||
+            !createSparseReader(sparse["values"], reader.componentType, reader.components, valuesReader) ||
+            (indicesReader.componentType != 5121u && indicesReader.componentType != 5123u && indicesReader.componentType != 5125u))
+        {
+            return false;
+        }
+
+        std::vector<float> values(sparseCount * reader.components);
+        readAccessor(valuesReader, 0u, sparseCount, values.data());
+
+        for (std::size_t i = 0u; i < sparseCount; i++)
+        {
+            // Indices are unsigned integers, which are not decoded as float to stay exact.
+            std::uint32_t index{0u};
+            std::memcpy(&index, indicesReader.data + indicesReader.byteStride * i, indicesReader.byteStride);
+            if (index >= reader.count)
+            {
+                return false;
+            }
+
+            std::copy_n(values.data() + i * reader.components, reader.components, reader.storage.data() + index * reader.components);
+        }
+    }
+
+    reader.data = reinterpret_cast<const char*>(reader.storage.data());
+    reader.byteStride = static_cast<std::size_t>(reader.components) * sizeof(float);
+    reader.componentType = 5126u;
+    reader.normalized = false;
+
+    return true;
+}
+
+//
+// Splat primitives
+//
+
+struct SplatPrimitive
+{
+    std::size_t count{0u};
+    std::uint32_t degree{0u};
+
+    AccessorReader position{};
+    AccessorReader rotation{};
+    AccessorReader scale{};
+    AccessorReader opacity{};
+    // Degree 0 coefficient, or COLOR_0 in case it is missing.
+    AccessorReader color{};
+    bool hasShColor{false};
+
+    // SH_DEGREE_l_COEF_n for l > 0, ordered by degree and coefficient.
+    std::vector<AccessorReader> coefficients{};
+};
+
+static const json* findAttribute(const json& attributes, const std::string& name)
+{
+    // Current naming of KHR_gaussian_splatting and the underscore prefix of custom attributes used by earlier exporters.
+    for (const std::string& candidate : {"KHR_gaussian_splatting:" + name, "_" + name, name})
+    {
+        if (attributes.contains(candidate))
+        {
+            return &attributes[candidate];
+        }
+    }
+
+    return nullptr;
+}
+
+// Looks up the codebook entry of every splat, so the coefficients of EXT_gaussian_splatting_sh_palette are decoded like attributes.
+static bool expandShPalette(const GltfAsset& asset, const json& extension, SplatPrimitive& splats)
+{
+    const std::uint32_t degree = std::min(extension.value("degree", 0u), maxDegree);
+
+    AccessorReader indexReader{};
+    if (!extension.contains("index") || !extension.contains("coefficients") || !createReader(asset, extension["index"].get<std::size_t>(), 1u, indexReader) || indexReader.count < splats.count)
+    {
+        return false;
+    }
+
+    // Indices are at most unsigned short, so they stay exact as float.
+    std::vector<float> indices(splats.count * indexReader.components);
+    readAccessor(indexReader, 0u, splats.count, indices.data());
+
+    const json& coefficients = extension["coefficients"];
+
+    for (std::uint32_t l = 1u; l <= degree; l++)
+    {
+        for (std::uint32_t n = 0u; n < 1u + 2u * l; n++)
+        {
+            const std::string name{"SH_DEGREE_" + std::to_string(l) + "_COEF_" + std::to_string(n)};
+
+            AccessorReader codebookReader{};
+            if (!coefficients.contains(name) || !createReader(asset, coefficients[name].get<std::size_t>(), 3u, codebookReader))
+            {
+                return false;
+            }
+
+            std::vector<float> codebook(codebookReader.count * codebookReader.components);
+            readAccessor(codebookReader, 0u, codebookReader.count, codebook.data());
+
+            AccessorReader reader{};
+            reader.storage.resize(splats.count * 3u);
+
+            for (std::size_t i = 0u; i < splats.count; i++)
+            {
+                const float index = indices[indexReader.components * i];
+                if (!(index >= 0.0f && index < static_cast<float>(codebookReader.count)))
+                {
+                    return false;
+                }
+
+                std::copy_n(codebook.data() + static_cast<std::size_t>(index) * codebookReader.components, 3u, reader.storage.data() + 3u * i);
+            }
+
+            reader.data = reinterpret_cast<const char*>(reader.storage.data());
+            reader.byteStride = 3u * sizeof(float);
+            reader.count = splats.count;
+            reader.componentType = 5126u;
+            reader.components = 3u;
+
+            splats.coefficients.push_back(std::move(reader));
+        }
+
+        splats.degree = l;
+    }
+
+    return true;
+}
+
+static bool createPrimitive(const GltfAsset& asset, const json& primitive, SplatPrimitive& splats)
+{
+    const json& attributes = primitive["attributes"];
+
+    const json* position = findAttribute(attributes, "POSITION");
+    const json* rotation = findAttribute(attributes, "ROTATION");
+    const json* scale = findAttribute(attributes, "SCALE");
+    const json* opacity = findAttribute(attributes, "OPACITY");
+    const json* shColor = findAttribute(attributes, "SH_DEGREE_0_COEF_0");
+    const json* color = findAttribute(attributes, "COLOR_0");
+
+    if (!position || !rotation || !scale || (!shColor && !color))
+    {
+        printf("Error: Primitive is missing KHR_gaussian_splatting attributes\n");
+
+        return false;
+    }
+
+    splats.hasShColor = shColor != nullptr;
+
+    if (!createReader(asset, position->get<std::size_t>(), 3u, splats.position) ||
+        !createReader(asset, rotation->get<std::size_t>(), 4u, splats.rotation) ||
+        !createReader(asset, scale->get<std::size_t>(), 3u, splats.scale) ||
+        !createReader(asset, (shColor ? shColor : color)->get<std::size_t>(), 3u, splats.color))
+    {
+        printf("Error: Invalid accessor of primitive\n");
+
+        return false;
+    }
+
+    // Opacity can also be the alpha channel of COLOR_0.
+    if (opacity)
+    {
+        if (!createReader(asset, opacity->get<std::size_t>(), 1u, splats.opacity))
+        {
+            printf("Error: Invalid accessor of primitive\n");
+
+            return false;
+        }
+    }
+    else if (color && createReader(asset, color->get<std::size_t>(), 4u, splats.opacity))
+    {
+        // Reading VEC4 element, of which the alpha is picked when writing.
+    }
+    else
+    {
+        printf("Error: Primitive is missing opacity\n");
+
+        return false;
+    }
+
+    splats.count = splats.position.count;
+
+    // Highest degree with all coefficients.
+    for (std::uint32_t l = 1u; l <= maxDegree; l++)
+    {
+        std::vector<AccessorReader> band{};
+        for (std::uint32_t n = 0u; n < 1u + 2u * l; n++)
+        {
+            const json* coefficient = findAttribute(attributes, "SH_DEGREE_" + std::to_string(l) + "_COEF_" + std::to_string(n));
+
+            AccessorReader reader{};
+            if (!coefficient || !createReader(asset, coefficient->get<std::size_t>(), 3u, reader))
+            {
+                break;
+            }
+
+            band.push_back(std::move(reader));
+        }
+
+        if (band.size() != 1u + 2u * l)
+        {
+            break;
+        }
+
+        for (auto& reader : band)
+        {
+            splats.coefficients.push_back(std::move(reader));
+        }
+        splats.degree = l;
+    }
+
+    // Higher degrees of --sh-palette are only stored in the codebook.
+    if (splats.degree == 0u && primitive.contains("extensions") && primitive["extensions"].contains("EXT_gaussian_splatting_sh_palette"))
+    {
+        if (!expandShPalette(asset, primitive["extensions"]["EXT_gaussian_splatting_sh_palette"], splats))
+        {
+            printf("Error: Invalid EXT_gaussian_splatting_sh_palette of primitive\n");
+
+            return false;
+        }
+    }
+
+    for (const AccessorReader* reader : {&splats.rotation, &splats.scale, &splats.opacity, &splats.color})
+    {
+        if (reader->count < splats.count)
+        {
+            printf("Error: Accessor has less elements than POSITION\n");
+
+            return false;
+        }
+    }
+    for (const auto& reader : splats.coefficients)
+    {
+        if (reader.count < splats.count)
+        {
+            printf("Error: Accessor has less elements than POSITION\n");
+
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Collects the meshes of the scene. Levels of detail are only referenced by extensions, so they are not visited.
+static void gatherMeshes(const json& glTF, std::size_t nodeIndex, std::vector<std::size_t>& meshes, bool& transformed)
+{
+    if (!glTF.contains("nodes") || nodeIndex >= glTF["nodes"].size())
+    {
+        return;
+    }
+
+    const json& node = glTF["nodes"][nodeIndex];
+
+    if (node.contains("mesh"))
+    {
+        const std::size_t mesh = node["mesh"].get<std::size_t>();
+        if (std::find(meshes.begin(), meshes.end(), mesh) == meshes.end())
+        {
+            meshes.push_back(mesh);
+        }
+    }
+
+    if (node.contains("matrix") || node.contains("translation") || node.contains("rotation") || node.contains("scale"))
+    {
+        transformed = true;
+    }
+
+    if (node.contains("children"))
+    {
+        for (const auto& child : node["children"])
+        {
+            gatherMeshes(glTF, child.get<std::size_t>(), meshes, transformed);
+        }
+    }
+}
+
+//
+// PLY output
+//
+
+// Header in the property order of the original 3DGS implementation.
+static std::string createStandardPlyHeader(std::size_t count, std::uint32_t degree)
+{
+    std::string header{};
+
+    header += "ply\n";
+    header += "format binary_little_endian 1.0\n";
+    header += "element vertex " + std::to_string(count) + "\n";
+
+    for (const char* name : {"x", "y", "z", "nx", "ny", "nz", "f_dc_0", "f_dc_1", "f_dc_2"})
+    {
+        header += std::string("property float ") + name + "\n";
+    }
+
+    std::uint32_t coefficients{0u};
+    for (std::uint32_t l = 1u; l <= degree; l++)
+    {
+        coefficients += 1u + 2u * l;
+    }
+    for (std::uint32_t rest = 0u; rest < 3u * coefficients; rest++)
+    {
+        header += "property float f_rest_" + std::to_string(rest) + "\n";
+    }
+
+    for (const char* name : {"opacity", "scale_0", "scale_1", "scale_2", "rot_0", "rot_1", "rot_2", "rot_3"})
+    {
+        header += std::string("property float ") + name + "\n";
+    }
+
+    header += "end_header\n";
+
+    return header;
+}
+
+// Writes splats [begin, end) of the primitive as PLY records, undoing the activations applied by the conversion.
+static void writeRecords(const SplatPrimitive& splats, std::size_t begin, std::size_t end, std::uint32_t degree, float* scratch, float* output)
+{
+    std::uint32_t coefficients{0u};
+    for (std::uint32_t l = 1u; l <= degree; l++)
+    {
+        coefficients += 1u + 2u * l;
+    }
+
+    const std::size_t recordFloats{17u + 3u * coefficients};
+    const std::size_t size{end - begin};
+
+    // Scratch holds the decoded attributes of the block one after the other.
+    float* position = scratch;
+    float* rotation = position + 3u * size;
+    float* scale = rotation + 4u * size;
+    float* color = scale + 3u * size;
+    float* opacity = color + 4u * size;
+    float* rests = opacity + 4u * size;
+
+    readAccessor(splats.position, begin, end, position);
+    readAccessor(splats.rotation, begin, end, rotation);
+    readAccessor(splats.scale, begin, end, scale);
+    readAccessor(splats.color, begin, end, color);
+    readAccessor(splats.opacity, begin, end, opacity);
+    for (std::uint32_t k = 0u; k < coefficients; k++)
+    {
+        readAccessor(splats.coefficients[k], begin, end, rests + 3u * size * k);
+    }
+
+    const std::uint32_t colorComponents{splats.color.components};
+    const std::uint32_t opacityComponents{splats.opacity.components};
+
+    for (std::size_t i = 0u; i < size; i++)
+    {
+        float* record = output + recordFloats * i;
+
+        record[0u] = position[3u * i + 0u];
+        record[1u] = position[3u * i + 1u];
+        record[2u] = position[3u * i + 2u];
+
+        // Normals are unused.
+        record[3u] = 0.0f;
+        record[4u] = 0.0f;
+        record[5u] = 0.0f;
+
+        for (std::uint32_t c = 0u; c < 3u; c++)
+        {
+            const float value = color[colorComponents * i + c];
+
+            record[6u + c] = splats.hasShColor ? value : (value - 0.5f) / shC0;
+        }
+
+        // Rests are ordered by channel, then coefficient.
+        for (std::uint32_t k = 0u; k < coefficients; k++)
+        {
+            for (std::uint32_t c = 0u; c < 3u; c++)
+            {
+                record[9u + c * coefficients + k] = rests[3u * size * k + 3u * i + c];
+            }
+        }
+
+        float* tail = record + 9u + 3u * coefficients;
+
+        // Inverse sigmoid, clamped to keep fully opaque and transparent splats finite.
+        const float alpha = std::clamp(opacity[opacityComponents * i + opacityComponents - 1u], 1e-6f, 1.0f - 1e-6f);
+        tail[0u] = std::log(alpha / (1.0f - alpha));
+
+        for (std::uint32_t c = 0u; c < 3u; c++)
+        {
+            tail[1u + c] = std::log(std::max(scale[3u * i + c], std::numeric_limits<float>::min()));
+        }
+
+        // PLY stores w first.
+        tail[4u] = rotation[4u * i + 3u];
+        tail[5u] = rotation[4u * i + 0u];
+        tail[6u] = rotation[4u * i + 1u];
+        tail[7u] = rotation[4u * i + 2u];
+    }
+}
+
+bool decodeGltf(const std::string& filename, const std::string& savename)
+{
+    GltfAsset asset{};
+    if (!loadAsset(filename, asset))
+    {
+        return false;
+    }
+
+    const json& glTF = asset.glTF;
+
+    //
+    // Gathering the splat primitives of the scene.
+    //
+
+    std::vector<std::size_t> meshes{};
+    bool transformed{false};
+
+    if (glTF.contains("scenes") && !glTF["scenes"].empty())
+    {
+        const json& scene = glTF["scenes"][std::min(glTF.value("scene", std::size_t{0u}), glTF["scenes"].size() - 1u)];
+        if (scene.contains("nodes"))
+        {
+            for (const auto& node : scene["nodes"])
+            {
+                gatherMeshes(glTF, node.get<std::size_t>(), meshes, transformed);
+            }
+        }
+    }
+    else if (glTF.contains("meshes"))
+    {
+        for (std::size_t mesh = 0u; mesh < glTF["meshes"].size(); mesh++)
+        {
+            meshes.push_back(mesh);
+        }
+    }
+
+    if (transformed)
+    {
+        printf("Warning: Node transforms are not applied to the splats\n");
+    }
+
+    std::vector<SplatPrimitive> primitives{};
+    for (std::size_t mesh : meshes)
+    {
+        if (!glTF.contains("meshes") || mesh >= glTF["meshes"].size())
+        {
+            printf("Error: Invalid mesh %zu\n", mesh);
+
+            return false;
+        }
+
+        for (const auto& primitive : glTF["meshes"][mesh].value("primitives", json::array()))
+        {
+            if (!primitive.contains("extensions") || !primitive["extensions"].contains("KHR_gaussian_splatting") || !primitive.contains("attributes"))
+            {
+                continue;
+            }
+
+            SplatPrimitive splats{};
+            if (!createPrimitive(asset, primitive, splats))
+            {
+                return false;
+            }
+
+            primitives.push_back(std::move(splats));
+        }
+    }
+
+    if (primitives.empty())
+    {
+        printf("Error: No KHR_gaussian_splatting primitive in '%s'\n", filename.c_str());
+
+        return false;
+    }
+
+    // All primitives are written with the lowest common degree.
+    std::size_t count{0u};
+    std::uint32_t degree{maxDegree};
+    for (const auto& splats : primitives)
+    {
+        count += splats.count;
+        degree = std::min(degree, splats.degree);
+    }
+
+    printf("Info: Decoding %zu splats of %zu primitives with degree %u\n", count, primitives.size(), degree);
+
+    //
+    // Writing the PLY in parallel.
+    //
+
+    std::uint32_t coefficients{0u};
+    for (std::uint32_t l = 1u; l <= degree; l++)
+    {
+        coefficients += 1u + 2u * l;
+    }
+    const std::size_t recordSize{(17u + 3u * static_cast<std::size_t>(coefficients)) * sizeof(float)};
+
+    const std::string header = createStandardPlyHeader(count, degree);
+
+    std::string ply(header.size() + recordSize * count, 0);
+    std::memcpy(ply.data(), header.data(), header.size());
+
+    std::size_t recordOffset{0u};
+    for (const auto& splats : primitives)
+    {
+        char* output = ply.data() + header.size() + recordSize * recordOffset;
+
+        const std::size_t blocks = (splats.count + blockSize - 1u) / blockSize;
+
+        parallelFor(0u, blocks, [&](std::size_t blockBegin, std::size_t blockEnd) {
+            std::vector<float> scratch(blockSize * (3u + 4u + 3u + 4u + 4u + 3u * maxCoefficients));
+            std::vector<float> records(blockSize * recordSize / sizeof(float));
+
+            for (std::size_t block = blockBegin; block < blockEnd; block++)
+            {
+                const std::size_t begin{block * blockSize};
+                const std::size_t end = std::min(begin + blockSize, splats.count);
+
+                // Written through a buffer, as the records in the PLY are not aligned to float.
+                writeRecords(splats, begin, end, degree, scratch.data(), records.data());
+
+                std::memcpy(output + recordSize * begin, records.data(), recordSize * (end - begin));
+            }
+        });
+
+        recordOffset += splats.count;
+    }
+
+    if (!saveFile(ply, savename))
+    {
+        printf("Error: Could not save '%s'\n", savename.c_str());
+
+        return false;
+    }
+
+    printf("Info: Saved '%s'\n", savename.c_str());
+
+    return true;
+}
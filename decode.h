@@ -0,0 +1,10 @@
+#ifndef GLTF_DECODE_H
+#define GLTF_DECODE_H
+
+#include <string>
+
+// Decodes the KHR_gaussian_splatting primitives of the scene of any glTF or GLB asset and saves them as standard 3DGS PLY.
+// Accessors can be in any order and bufferView, of any component type and normalized or sparse. Buffers are memory mapped.
+bool decodeGltf(const std::string& filename, const std::string& savename);
+
+#endif /*GLTF_DECODE_H*/
@@ -1,8 +1,21 @@
 #include "dump.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <limits>
 #include <vector>
 
+#include "parallel.h"
+
+// Splats per chunk of the compressed PLY.
+constexpr std::uint32_t chunkSplats{256u};
+
+// Bounds of position, scale and color per chunk.
+constexpr std::uint32_t chunkProperties{18u};
+
+constexpr float shC0{0.28209479177387814f};
+
 void appendLittleEndian(std::string& dump, float value)
 {
     const std::uint8_t* data = reinterpret_cast<const std::uint8_t*>(&value);
@@ -12,101 +25,53 @@ void appendLittleEndian(std::string& dump, float value)
     dump += data[3u];
 }
 
-std::string dumpPly(const std::string& binary, std::uint32_t count, std::uint32_t byteStride, std::uint32_t degree)
+std::string createPlyHeader(std::uint32_t count, std::uint32_t degree)
 {
-    std::string dump{};
-
-    dump += "ply\n";
-    dump += "format binary_little_endian 1.0\n";
-    dump += "element vertex " + std::to_string(count) + "\n";
-    dump += "property float x\n";
-    dump += "property float y\n";
-    dump += "property float z\n";
-    dump += "property float rot_0\n";
-    dump += "property float rot_1\n";
-    dump += "property float rot_2\n";
-    dump += "property float rot_3\n";
-    dump += "property float scale_0\n";
-    dump += "property float scale_1\n";
-    dump += "property float scale_2\n";
-    dump += "property float opacity\n";
-
-    dump += "property float f_dc_0\n";
-    dump += "property float f_dc_1\n";
-    dump += "property float f_dc_2\n";
-    if (degree > 0u)
+    std::string header{};
+
+    header += "ply\n";
+    header += "format binary_little_endian 1.0\n";
+    header += "element vertex " + std::to_string(count) + "\n";
+    header += "property float x\n";
+    header += "property float y\n";
+    header += "property float z\n";
+    header += "property float rot_0\n";
+    header += "property float rot_1\n";
+    header += "property float rot_2\n";
+    header += "property float rot_3\n";
+    header += "property float scale_0\n";
+    header += "property float scale_1\n";
+    header += "property float scale_2\n";
+    header += "property float opacity\n";
+
+    header += "property float f_dc_0\n";
+    header += "property float f_dc_1\n";
+    header += "property float f_dc_2\n";
+
+    // Three channels per coefficient of every higher degree.
+    std::uint32_t rests{0u};
+    for (std::uint32_t current_degree = 1u; current_degree <= degree; current_degree++)
     {
-        dump += "property float f_rest_0\n";
-        dump += "property float f_rest_1\n";
-        dump += "property float f_rest_2\n";
-
-        dump += "property float f_rest_3\n";
-        dump += "property float f_rest_4\n";
-        dump += "property float f_rest_5\n";
-
-        dump += "property float f_rest_6\n";
-        dump += "property float f_rest_7\n";
-        dump += "property float f_rest_8\n";
-
-        if (degree > 1u)
-        {
-            dump += "property float f_rest_9\n";
-            dump += "property float f_rest_10\n";
-            dump += "property float f_rest_11\n";
-
-            dump += "property float f_rest_12\n";
-            dump += "property float f_rest_13\n";
-            dump += "property float f_rest_14\n";
-
-            dump += "property float f_rest_15\n";
-            dump += "property float f_rest_16\n";
-            dump += "property float f_rest_17\n";
-
-            dump += "property float f_rest_18\n";
-            dump += "property float f_rest_19\n";
-            dump += "property float f_rest_20\n";
-
-            dump += "property float f_rest_21\n";
-            dump += "property float f_rest_22\n";
-            dump += "property float f_rest_23\n";
-
-            if (degree > 2u)
-            {
-
-                dump += "property float f_rest_24\n";
-                dump += "property float f_rest_25\n";
-                dump += "property float f_rest_26\n";
-
-                dump += "property float f_rest_27\n";
-                dump += "property float f_rest_28\n";
-                dump += "property float f_rest_29\n";
-
-                dump += "property float f_rest_30\n";
-                dump += "property float f_rest_31\n";
-                dump += "property float f_rest_32\n";
+        rests += 3u * (1u + 2u * current_degree);
+    }
+    for (std::uint32_t rest = 0u; rest < rests; rest++)
+    {
+        header += "property float f_rest_" + std::to_string(rest) + "\n";
+    }
 
-                dump += "property float f_rest_33\n";
-                dump += "property float f_rest_34\n";
-                dump += "property float f_rest_35\n";
+    header += "end_header\n";
 
-                dump += "property float f_rest_36\n";
-                dump += "property float f_rest_37\n";
-                dump += "property float f_rest_38\n";
+    return header;
+}
 
-                dump += "property float f_rest_39\n";
-                dump += "property float f_rest_40\n";
-                dump += "property float f_rest_41\n";
+std::string dumpPly(const std::string& binary, std::uint32_t count, std::uint32_t byteStride, std::uint32_t degree)
+{
+    std::string dump{};
 
-                dump += "property float f_rest_42\n";
-                dump += "property float f_rest_43\n";
-                dump += "property float f_rest_44\n";
-            }
-        }
-    }
-    dump += "end_header\n";
+    dump += createPlyHeader(count, degree);
 
     // Write binary
-    for (std::uint32_t vertex = 0u; vertex < count; vertex++)
+    for (std::size_t vertex = 0u; vertex < count; vertex++)
     {
         std::uint32_t byteOffset{0u};
         const float* data{nullptr};
@@ -276,3 +241,173 @@ std::string dumpPly(const std::string& binary, std::uint32_t count, std::uint32_
 
     return dump;
 }
+
+static std::uint32_t packUnorm(float value, std::uint32_t bits)
+{
+    const float levels = static_cast<float>((1u << bits) - 1u);
+
+    return static_cast<std::uint32_t>(std::clamp(std::floor(value * levels + 0.5f), 0.0f, levels));
+}
+
+// Normalized into the bounds, with all values of an empty range at the minimum.
+static float normalize(float value, float minimum, float maximum)
+{
+    return maximum > minimum ? (value - minimum) / (maximum - minimum) : 0.0f;
+}
+
+static std::uint32_t pack111011(const float* values, const float* minimum, const float* maximum)
+{
+    return packUnorm(normalize(values[0u], minimum[0u], maximum[0u]), 11u) << 21u | packUnorm(normalize(values[1u], minimum[1u], maximum[1u]), 10u) << 11u | packUnorm(normalize(values[2u], minimum[2u], maximum[2u]), 11u);
+}
+
+// Index of the largest component followed by the other three, scaled to [0, 1] from the range of [-1/sqrt(2), 1/sqrt(2)].
+static std::uint32_t packRotation(float* rotation)
+{
+    std::uint32_t largest{0u};
+    for (std::uint32_t i = 1u; i < 4u; i++)
+    {
+        if (std::abs(rotation[i]) > std::abs(rotation[largest]))
+        {
+            largest = i;
+        }
+    }
+
+    // q and -q are the same rotation, so the largest component is positive and can be reconstructed.
+    const float sign = rotation[largest] < 0.0f ? -1.0f : 1.0f;
+
+    std::uint32_t packed{largest};
+    for (std::uint32_t i = 0u; i < 4u; i++)
+    {
+        if (i != largest)
+        {
+            packed = packed << 10u | packUnorm(sign * rotation[i] * 0.70710678f + 0.5f, 10u);
+        }
+    }
+
+    return packed;
+}
+
+std::string compressPly(const std::string& binary, std::uint32_t count, std::uint32_t byteStride, std::uint32_t degree)
+{
+    const std::uint32_t chunks = (count + chunkSplats - 1u) / chunkSplats;
+    const std::uint32_t rests = 3u * ((degree + 1u) * (degree + 1u) - 1u);
+
+    std::string header{};
+
+    header += "ply\n";
+    header += "format binary_little_endian 1.0\n";
+    header += "element chunk " + std::to_string(chunks) + "\n";
+    for (const char* bound : {"min", "max"})
+    {
+        header += std::string{"property float "} + bound + "_x\n";
+        header += std::string{"property float "} + bound + "_y\n";
+        header += std::string{"property float "} + bound + "_z\n";
+    }
+    for (const char* bound : {"min", "max"})
+    {
+        header += std::string{"property float "} + bound + "_scale_x\n";
+        header += std::string{"property float "} + bound + "_scale_y\n";
+        header += std::string{"property float "} + bound + "_scale_z\n";
+    }
+    for (const char* bound : {"min", "max"})
+    {
+        header += std::string{"property float "} + bound + "_r\n";
+        header += std::string{"property float "} + bound + "_g\n";
+        header += std::string{"property float "} + bound + "_b\n";
+    }
+    header += "element vertex " + std::to_string(count) + "\n";
+    header += "property uint packed_position\n";
+    header += "property uint packed_rotation\n";
+    header += "property uint packed_scale\n";
+    header += "property uint packed_color\n";
+    if (rests > 0u)
+    {
+        header += "element sh " + std::to_string(count) + "\n";
+        for (std::uint32_t rest = 0u; rest < rests; rest++)
+        {
+            header += "property uchar f_rest_" + std::to_string(rest) + "\n";
+        }
+    }
+    header += "end_header\n";
+
+    const std::size_t chunksByteOffset{header.size()};
+    const std::size_t verticesByteOffset{chunksByteOffset + static_cast<std::size_t>(chunks) * chunkProperties * sizeof(float)};
+    const std::size_t restsByteOffset{verticesByteOffset + static_cast<std::size_t>(count) * 4u * sizeof(std::uint32_t)};
+
+    std::string compressed(restsByteOffset + static_cast<std::size_t>(count) * rests, '\0');
+    std::memcpy(compressed.data(), header.data(), header.size());
+
+    // Chunks are independent, so each is written by one thread.
+    parallelFor(0u, chunks, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t chunk = begin; chunk < end; chunk++)
+        {
+            const std::size_t first{chunk * chunkSplats};
+            const std::size_t last = std::min<std::size_t>(first + chunkSplats, count);
+
+            // Position, log scale and color per splat, followed by the bounds.
+            float values[chunkSplats][9];
+            float bounds[chunkProperties];
+            for (std::uint32_t i = 0u; i < 9u; i++)
+            {
+                bounds[(i / 3u) * 6u + i % 3u] = std::numeric_limits<float>::max();
+                bounds[(i / 3u) * 6u + 3u + i % 3u] = std::numeric_limits<float>::lowest();
+            }
+
+            for (std::size_t vertex = first; vertex < last; vertex++)
+            {
+                const float* data = reinterpret_cast<const float*>(binary.data() + byteStride * vertex);
+                float* value = values[vertex - first];
+
+                for (std::uint32_t i = 0u; i < 3u; i++)
+                {
+                    value[i] = data[i];
+                    // Clamped like PlayCanvas, as the logarithm of degenerated splats is unbounded.
+                    value[3u + i] = std::clamp(std::log(data[7u + i]), -20.0f, 20.0f);
+                    value[6u + i] = 0.5f + shC0 * data[11u + i];
+                }
+
+                for (std::uint32_t i = 0u; i < 9u; i++)
+                {
+                    float& minimum = bounds[(i / 3u) * 6u + i % 3u];
+                    float& maximum = bounds[(i / 3u) * 6u + 3u + i % 3u];
+
+                    minimum = std::min(minimum, value[i]);
+                    maximum = std::max(maximum, value[i]);
+                }
+            }
+
+            std::memcpy(compressed.data() + chunksByteOffset + chunk * chunkProperties * sizeof(float), bounds, sizeof(bounds));
+
+            for (std::size_t vertex = first; vertex < last; vertex++)
+            {
+                const float* data = reinterpret_cast<const float*>(binary.data() + byteStride * vertex);
+                const float* value = values[vertex - first];
+
+                // Component order w, x, y and z of the PLY properties rot_0 to rot_3.
+                float rotation[4]{data[6u], data[3u], data[4u], data[5u]};
+
+                std::uint32_t packed[4];
+                packed[0u] = pack111011(&value[0u], &bounds[0u], &bounds[3u]);
+                packed[1u] = packRotation(rotation);
+                packed[2u] = pack111011(&value[3u], &bounds[6u], &bounds[9u]);
+                packed[3u] = packUnorm(normalize(value[6u], bounds[12u], bounds[15u]), 8u) << 24u | packUnorm(normalize(value[7u], bounds[13u], bounds[16u]), 8u) << 16u | packUnorm(normalize(value[8u], bounds[14u], bounds[17u]), 8u) << 8u | packUnorm(data[10u], 8u);
+
+                std::memcpy(compressed.data() + verticesByteOffset + vertex * sizeof(packed), packed, sizeof(packed));
+
+                // Channel by channel like f_rest of the PLY, each coefficient mapped from [-4, 4].
+                std::uint8_t* rest = reinterpret_cast<std::uint8_t*>(compressed.data() + restsByteOffset + vertex * rests);
+                for (std::uint32_t coefficient = 0u; coefficient < rests / 3u; coefficient++)
+                {
+                    for (std::uint32_t channel = 0u; channel < 3u; channel++)
+                    {
+                        const float coefficientValue = data[14u + 3u * coefficient + channel];
+
+                        rest[channel * (rests / 3u) + coefficient] = static_cast<std::uint8_t>(std::clamp(std::trunc((coefficientValue / 8.0f + 0.5f) * 256.0f), 0.0f, 255.0f));
+                    }
+                }
+            }
+        }
+    });
+
+    return compressed;
+}
@@ -4,6 +4,14 @@
 #include <cstdint>
 #include <string>
 
+// PLY header in the property order written by dumpPly.
+std::string createPlyHeader(std::uint32_t count, std::uint32_t degree);
+
 std::string dumpPly(const std::string& binary, std::uint32_t count, std::uint32_t byteStride, std::uint32_t degree);
 
+// Compressed PLY as read by PlayCanvas: chunks of 256 splats with the bounds of position, log scale and color, and per splat
+// 11/10/11 bit positions and scales, smallest three quaternions, 8 bit colors with opacity and 8 bit higher degree coefficients.
+// Chunks are only compact, if nearby splats are consecutive, e.g. after sorting by Morton order.
+std::string compressPly(const std::string& binary, std::uint32_t count, std::uint32_t byteStride, std::uint32_t degree);
+
 #endif /*GLTF_DUMP_H*/
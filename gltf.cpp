@@ -0,0 +1,539 @@
+#include "gltf.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <limits>
+#include <string_view>
+
+#include "io.h"
+
+using json = nlohmann::json;
+
+std::uint32_t getByteStride(std::uint32_t degree)
+{
+    // POSITION, ROTATION, SCALE, OPACITY and SH_DEGREE_0_COEF_0.
+    std::uint32_t byteStride{(3u + 4u + 3u + 1u + 3u) * static_cast<std::uint32_t>(sizeof(float))};
+
+    for (std::uint32_t current_l = 1u; current_l <= degree; current_l++)
+    {
+        byteStride += (1u + 2u * current_l) * 3u * sizeof(float);
+    }
+
+    return byteStride;
+}
+
+void getPositionBounds(const std::string& binary, std::uint32_t count, std::uint32_t byteStride, float minPosition[3], float maxPosition[3])
+{
+    for (std::uint32_t i = 0u; i < 3u; i++)
+    {
+        minPosition[i] = std::numeric_limits<float>::max();
+        maxPosition[i] = std::numeric_limits<float>::lowest();
+    }
+
+    for (std::size_t vertex = 0u; vertex < count; vertex++)
+    {
+        // Position is written at first position, so no offset required.
+        const float* data = reinterpret_cast<const float*>(binary.data() + byteStride * vertex);
+
+        for (std::uint32_t i = 0u; i < 3u; i++)
+        {
+            if (data[i] < minPosition[i])
+            {
+                minPosition[i] = data[i];
+            }
+            if (data[i] > maxPosition[i])
+            {
+                maxPosition[i] = data[i];
+            }
+        }
+    }
+}
+
+std::string changeDegree(const std::string& binary, std::uint32_t count, std::uint32_t degree, std::uint32_t newDegree)
+{
+    const std::uint32_t byteStride = getByteStride(degree);
+    const std::uint32_t newByteStride = getByteStride(newDegree);
+    const std::uint32_t commonByteStride = std::min(byteStride, newByteStride);
+
+    std::string result(static_cast<std::size_t>(newByteStride) * count, '\0');
+
+    // Higher degrees follow the lower ones in the record, so the common part is a prefix.
+    for (std::size_t vertex = 0u; vertex < count; vertex++)
+    {
+        std::copy_n(binary.data() + byteStride * vertex, commonByteStride, result.data() + newByteStride * vertex);
+    }
+
+    return result;
+}
+
+std::uint32_t addMesh(json& glTF, std::size_t byteOffset, std::size_t byteLength, std::uint32_t count, std::uint32_t degree, const float minPosition[3], const float maxPosition[3])
+{
+    const std::uint32_t byteStride = getByteStride(degree);
+
+    //
+
+    const std::size_t bufferViewIndex = glTF["bufferViews"].size();
+
+    json bufferView = json::object();
+    bufferView["buffer"] = 0;
+    if (byteOffset > 0u)
+    {
+        bufferView["byteOffset"] = byteOffset;
+    }
+    bufferView["byteLength"] = byteLength;
+    bufferView["byteStride"] = byteStride;
+    bufferView["target"] = 34962;
+
+    glTF["bufferViews"].push_back(bufferView);
+
+    //
+
+    json primitive = json::object();
+    primitive["mode"] = 0;
+    primitive["attributes"] = json::object();
+    primitive["extensions"] = json::object();
+    primitive["extensions"]["KHR_gaussian_splatting"] = json::object();
+    primitive["extensions"]["KHR_gaussian_splatting"]["kernel"] = "ellipse";
+    primitive["extensions"]["KHR_gaussian_splatting"]["colorSpace"] = "srgb_rec709_display";
+
+    //
+
+    const std::size_t positionAccessorIndex = glTF["accessors"].size();
+
+    const char* names[5u]{"POSITION", "ROTATION", "SCALE", "OPACITY", "SH_DEGREE_0_COEF_0"};
+    const char* types[5u]{"VEC3", "VEC4", "VEC3", "SCALAR", "VEC3"};
+    const std::uint32_t components[5u]{3u, 4u, 3u, 1u, 3u};
+
+    std::uint32_t attributeByteOffset{0u};
+    for (std::uint32_t i = 0u; i < 5u; i++)
+    {
+        json accessor = json::object();
+        accessor["name"] = names[i];
+        accessor["bufferView"] = bufferViewIndex;
+        accessor["byteOffset"] = attributeByteOffset;
+        accessor["componentType"] = 5126;
+        accessor["count"] = count;
+        accessor["type"] = types[i];
+
+        std::string attribute{names[i]};
+        if (i > 0u)
+        {
+            attribute = "KHR_gaussian_splatting:" + attribute;
+        }
+        primitive["attributes"][attribute] = glTF["accessors"].size();
+
+        glTF["accessors"].push_back(accessor);
+
+        attributeByteOffset += components[i] * sizeof(float);
+    }
+
+    // Generate accessors depending on degrees.
+    for (std::uint32_t current_l = 1u; current_l <= degree; current_l++)
+    {
+        for (std::uint32_t current_n = 0u; current_n < 1u + 2u * current_l; current_n++)
+        {
+            std::string current_name{"SH_DEGREE_" + std::to_string(current_l) + "_COEF_" + std::to_string(current_n)};
+
+            json accessor = json::object();
+            accessor["name"] = current_name;
+            accessor["bufferView"] = bufferViewIndex;
+            accessor["byteOffset"] = attributeByteOffset;
+            accessor["componentType"] = 5126;
+            accessor["count"] = count;
+            accessor["type"] = "VEC3";
+
+            primitive["attributes"]["KHR_gaussian_splatting:" + current_name] = glTF["accessors"].size();
+
+            glTF["accessors"].push_back(accessor);
+
+            attributeByteOffset += 3u * sizeof(float);
+        }
+    }
+
+    json& positionAccessor = glTF["accessors"][positionAccessorIndex];
+    positionAccessor["min"] = json::array();
+    positionAccessor["max"] = json::array();
+    for (std::uint32_t i = 0u; i < 3u; i++)
+    {
+        positionAccessor["min"].push_back(minPosition[i]);
+        positionAccessor["max"].push_back(maxPosition[i]);
+    }
+
+    //
+
+    const std::size_t meshIndex = glTF["meshes"].size();
+
+    json mesh = json::object();
+    mesh["primitives"] = json::array();
+    mesh["primitives"].push_back(primitive);
+
+    glTF["meshes"].push_back(mesh);
+
+    return static_cast<std::uint32_t>(meshIndex);
+}
+
+std::uint32_t addMesh(json& glTF, std::size_t byteOffset, const std::string& binary, std::uint32_t count, std::uint32_t degree)
+{
+    // Gather min and max for POSITION, as required by specification.
+    float minPosition[3];
+    float maxPosition[3];
+    getPositionBounds(binary, count, getByteStride(degree), minPosition, maxPosition);
+
+    return addMesh(glTF, byteOffset, binary.size(), count, degree, minPosition, maxPosition);
+}
+
+json createGltf(const std::string& uri, std::size_t byteLength, std::uint32_t count, std::uint32_t degree, const float minPosition[3], const float maxPosition[3])
+{
+    // glTF main object
+
+    json glTF = json::object();
+
+    //
+
+    json asset = json::object();
+    asset["version"] = "2.0";
+    asset["generator"] = "3DGS PLY to glTF converter by Huawei";
+
+    glTF["asset"] = asset;
+
+    //
+
+    json extensionsUsed = json::array();
+    extensionsUsed.push_back("KHR_gaussian_splatting");
+
+    glTF["extensionsUsed"] = extensionsUsed;
+
+    json extensionsRequired = json::array();
+    extensionsRequired.push_back("KHR_gaussian_splatting");
+
+    glTF["extensionsRequired"] = extensionsRequired;
+
+    //
+
+    json buffers = json::array();
+
+    json buffer = json::object();
+    buffer["uri"] = uri;
+    buffer["byteLength"] = byteLength;
+
+    buffers.push_back(buffer);
+
+    glTF["buffers"] = buffers;
+
+    //
+
+    glTF["bufferViews"] = json::array();
+    glTF["accessors"] = json::array();
+    glTF["meshes"] = json::array();
+
+    addMesh(glTF, 0u, byteLength, count, degree, minPosition, maxPosition);
+
+    //
+
+    json nodes = json::array();
+
+    json node = json::object();
+    node["mesh"] = 0;
+
+    nodes.push_back(node);
+
+    glTF["nodes"] = nodes;
+
+    //
+
+    json scenes = json::array();
+
+    json scene = json::object();
+    scene["nodes"] = json::array();
+    scene["nodes"].push_back(0);
+
+    scenes.push_back(scene);
+
+    glTF["scenes"] = scenes;
+
+    glTF["scene"] = 0;
+
+    return glTF;
+}
+
+json createGltf(const std::string& uri, const std::string& binary, std::uint32_t count, std::uint32_t degree)
+{
+    float minPosition[3];
+    float maxPosition[3];
+    getPositionBounds(binary, count, getByteStride(degree), minPosition, maxPosition);
+
+    return createGltf(uri, binary.size(), count, degree, minPosition, maxPosition);
+}
+
+std::string getBufferUri(const std::string& uri, std::size_t index)
+{
+    if (index == 0u)
+    {
+        return uri;
+    }
+
+    const std::filesystem::path path(uri);
+
+    return path.stem().generic_string() + "_" + std::to_string(index) + path.extension().generic_string();
+}
+
+std::vector<BufferRange> splitBuffers(json& glTF, const std::string& binary, std::size_t maxBufferSize, const std::string& uri)
+{
+    if (binary.size() <= maxBufferSize)
+    {
+        return {BufferRange{0u, binary.size()}};
+    }
+
+    //
+    // Splitting interleaved bufferViews into parts of whole records.
+    //
+
+    json bufferViews = json::array();
+    std::vector<std::vector<std::size_t>> bufferViewParts(glTF["bufferViews"].size());
+
+    for (std::size_t i = 0u; i < glTF["bufferViews"].size(); i++)
+    {
+        const json& bufferView = glTF["bufferViews"][i];
+
+        const std::size_t byteOffset = bufferView.value("byteOffset", std::size_t{0u});
+        const std::size_t byteLength = bufferView["byteLength"].get<std::size_t>();
+        const std::size_t byteStride = bufferView.value("byteStride", std::size_t{0u});
+
+        std::size_t partByteLength{byteLength};
+        if (byteStride > 0u && byteLength > maxBufferSize)
+        {
+            partByteLength = std::max<std::size_t>(maxBufferSize / byteStride, 1u) * byteStride;
+        }
+
+        std::size_t partByteOffset{0u};
+        do
+        {
+            json part = bufferView;
+            part["byteOffset"] = byteOffset + partByteOffset;
+            part["byteLength"] = std::min(partByteLength, byteLength - partByteOffset);
+
+            bufferViewParts[i].push_back(bufferViews.size());
+            bufferViews.push_back(part);
+
+            partByteOffset += partByteLength;
+        } while (partByteOffset < byteLength);
+    }
+
+    json accessors = json::array();
+    std::vector<std::vector<std::size_t>> accessorParts(glTF["accessors"].size());
+
+    for (std::size_t i = 0u; i < glTF["accessors"].size(); i++)
+    {
+        const json& accessor = glTF["accessors"][i];
+
+        const std::vector<std::size_t>& parts = bufferViewParts[accessor["bufferView"].get<std::size_t>()];
+
+        const std::size_t count = accessor["count"].get<std::size_t>();
+        const std::size_t byteStride = bufferViews[parts[0]].value("byteStride", std::size_t{0u});
+        const std::size_t partCount{byteStride > 0u ? bufferViews[parts[0]]["byteLength"].get<std::size_t>() / byteStride : count};
+
+        // Accessors covering a prefix of the bufferView, e.g. of progressive levels, need less parts.
+        for (std::size_t p = 0u; p < parts.size() && (p == 0u || p * partCount < count); p++)
+        {
+            json part = accessor;
+            part["bufferView"] = parts[p];
+
+            if (parts.size() > 1u)
+            {
+                part["count"] = std::min(partCount, count - p * partCount);
+
+                // Bounds of each part, as required by specification e.g. for POSITION.
+                if (part.contains("min") && part["componentType"] == 5126)
+                {
+                    const std::size_t components = part["min"].size();
+
+                    std::vector<float> minimum(components, std::numeric_limits<float>::max());
+                    std::vector<float> maximum(components, std::numeric_limits<float>::lowest());
+
+                    const char* data = binary.data() + bufferViews[parts[p]]["byteOffset"].get<std::size_t>() + part.value("byteOffset", std::size_t{0u});
+                    for (std::size_t record = 0u; record < part["count"].get<std::size_t>(); record++)
+                    {
+                        const float* values = reinterpret_cast<const float*>(data + byteStride * record);
+
+                        for (std::size_t c = 0u; c < components; c++)
+                        {
+                            minimum[c] = std::min(minimum[c], values[c]);
+                            maximum[c] = std::max(maximum[c], values[c]);
+                        }
+                    }
+
+                    part["min"] = minimum;
+                    part["max"] = maximum;
+                }
+            }
+
+            accessorParts[i].push_back(accessors.size());
+            accessors.push_back(part);
+        }
+    }
+
+    const bool hasSplit{accessors.size() > glTF["accessors"].size()};
+
+    for (auto& mesh : glTF["meshes"])
+    {
+        json primitives = json::array();
+
+        for (const auto& primitive : mesh["primitives"])
+        {
+            std::size_t parts{1u};
+            for (const auto& attribute : primitive["attributes"])
+            {
+                parts = std::max(parts, accessorParts[attribute.get<std::size_t>()].size());
+            }
+
+            // Other extensions can reference accessors outside of the attributes, which are not remapped.
+            if (hasSplit && primitive.contains("extensions") && primitive["extensions"].size() > 1u)
+            {
+                printf("Error: Primitive with extensions can not be split across buffers\n");
+
+                return {};
+            }
+
+            for (std::size_t p = 0u; p < parts; p++)
+            {
+                json part = primitive;
+                for (auto& attribute : part["attributes"])
+                {
+                    const std::vector<std::size_t>& indices = accessorParts[attribute.get<std::size_t>()];
+
+                    attribute = indices[std::min(p, indices.size() - 1u)];
+                }
+
+                primitives.push_back(part);
+            }
+        }
+
+        mesh["primitives"] = primitives;
+    }
+
+    //
+    // Assigning consecutive bufferViews to buffers.
+    //
+
+    std::vector<BufferRange> bufferRanges{};
+
+    for (auto& bufferView : bufferViews)
+    {
+        const std::size_t byteOffset = bufferView["byteOffset"].get<std::size_t>();
+        const std::size_t byteLength = bufferView["byteLength"].get<std::size_t>();
+
+        if (bufferRanges.empty() || byteOffset + byteLength - bufferRanges.back().byteOffset > maxBufferSize)
+        {
+            bufferRanges.push_back(BufferRange{byteOffset, 0u});
+        }
+
+        BufferRange& bufferRange = bufferRanges.back();
+
+        bufferView["buffer"] = bufferRanges.size() - 1u;
+        if (byteOffset > bufferRange.byteOffset)
+        {
+            bufferView["byteOffset"] = byteOffset - bufferRange.byteOffset;
+        }
+        else
+        {
+            bufferView.erase("byteOffset");
+        }
+
+        bufferRange.byteLength = byteOffset + byteLength - bufferRange.byteOffset;
+    }
+
+    json buffers = json::array();
+    for (std::size_t i = 0u; i < bufferRanges.size(); i++)
+    {
+        json buffer = json::object();
+        buffer["uri"] = getBufferUri(uri, i);
+        buffer["byteLength"] = bufferRanges[i].byteLength;
+
+        buffers.push_back(buffer);
+    }
+
+    glTF["buffers"] = buffers;
+    glTF["bufferViews"] = bufferViews;
+    glTF["accessors"] = accessors;
+
+    return bufferRanges;
+}
+
+std::string createGlbHeader(const json& glTF, std::size_t binaryByteLength)
+{
+    // JSON chunk is padded with spaces, the binary chunk with zeros.
+    std::string jsonChunk = glTF.dump();
+    jsonChunk.resize((jsonChunk.size() + 3u) & ~std::size_t{3u}, ' ');
+
+    const std::size_t binaryChunkLength = (binaryByteLength + 3u) & ~std::size_t{3u};
+
+    const std::size_t length = 12u + 8u + jsonChunk.size() + 8u + binaryChunkLength;
+    if (length > std::numeric_limits<std::uint32_t>::max())
+    {
+        return {};
+    }
+
+    std::string header{};
+
+    auto append = [&](std::uint32_t value) {
+        header.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+
+    // 'glTF', version 2
+    append(0x46546C67u);
+    append(2u);
+    append(static_cast<std::uint32_t>(length));
+
+    // 'JSON'
+    append(static_cast<std::uint32_t>(jsonChunk.size()));
+    append(0x4E4F534Au);
+    header += jsonChunk;
+
+    // 'BIN'
+    append(static_cast<std::uint32_t>(binaryChunkLength));
+    append(0x004E4942u);
+
+    return header;
+}
+
+bool saveGltf(json& glTF, const std::string& binary, std::size_t maxBufferSize, const std::string& outputDirectory, const std::string& uri, const std::string& savenameJson, std::vector<std::string>& outputs)
+{
+    std::vector<BufferRange> bufferRanges = splitBuffers(glTF, binary, maxBufferSize, uri);
+    if (bufferRanges.empty())
+    {
+        printf("Error: Could not split output into buffers of at most %zu bytes\n", maxBufferSize);
+
+        return false;
+    }
+
+    for (std::size_t i = 0u; i < bufferRanges.size(); i++)
+    {
+        const std::string savenameBuffer = (std::filesystem::path(outputDirectory) / getBufferUri(uri, i)).generic_string();
+
+        if (!saveFile(std::string_view(binary).substr(bufferRanges[i].byteOffset, bufferRanges[i].byteLength), savenameBuffer))
+        {
+            printf("Error: Could not save '%s'\n", savenameBuffer.c_str());
+
+            return false;
+        }
+
+        printf("Info: Saved '%s'\n", savenameBuffer.c_str());
+
+        if (i > 0u)
+        {
+            outputs.push_back(savenameBuffer);
+        }
+    }
+
+    if (!saveFile(glTF.dump(3), savenameJson))
+    {
+        printf("Error: Could not save '%s'\n", savenameJson.c_str());
+
+        return false;
+    }
+
+    printf("Info: Saved '%s'\n", savenameJson.c_str());
+
+    return true;
+}
@@ -0,0 +1,52 @@
+#ifndef GLTF_GLTF_H
+#define GLTF_GLTF_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+// Byte size of one interleaved splat record for the given spherical harmonics degree.
+std::uint32_t getByteStride(std::uint32_t degree);
+
+// Gathers min and max of the POSITION attribute, which is always stored first in the record.
+void getPositionBounds(const std::string& binary, std::uint32_t count, std::uint32_t byteStride, float minPosition[3], float maxPosition[3]);
+
+// Copies the interleaved records into the given degree, padding the spherical harmonics with zeros or truncating them.
+std::string changeDegree(const std::string& binary, std::uint32_t count, std::uint32_t degree, std::uint32_t newDegree);
+
+// Adds a bufferView at byteOffset in the first buffer, the accessors and a mesh for the interleaved splats in binary. Returns the mesh index.
+std::uint32_t addMesh(nlohmann::json& glTF, std::size_t byteOffset, const std::string& binary, std::uint32_t count, std::uint32_t degree);
+
+// Creates the KHR_gaussian_splatting glTF referencing the interleaved binary buffer by the given uri.
+nlohmann::json createGltf(const std::string& uri, const std::string& binary, std::uint32_t count, std::uint32_t degree);
+
+// Variants for splats, which are not in memory, with their byte length and known POSITION bounds e.g. combined from parts.
+std::uint32_t addMesh(nlohmann::json& glTF, std::size_t byteOffset, std::size_t byteLength, std::uint32_t count, std::uint32_t degree, const float minPosition[3], const float maxPosition[3]);
+nlohmann::json createGltf(const std::string& uri, std::size_t byteLength, std::uint32_t count, std::uint32_t degree, const float minPosition[3], const float maxPosition[3]);
+
+// Part of the binary, which is stored as a separate buffer.
+struct BufferRange
+{
+    std::size_t byteOffset{0u};
+    std::size_t byteLength{0u};
+};
+
+// Name of the buffer at the given index, e.g. 'some_3dgs_1.bin' for index 1. The first buffer keeps the uri.
+std::string getBufferUri(const std::string& uri, std::size_t index);
+
+// Distributes the bufferViews over buffers of at most maxBufferSize bytes. Interleaved bufferViews exceeding this size are split
+// into whole records, each part with its own accessors and primitive. Returns the parts of binary per buffer, or nothing on failure.
+std::vector<BufferRange> splitBuffers(nlohmann::json& glTF, const std::string& binary, std::size_t maxBufferSize, const std::string& uri);
+
+// GLB header, JSON chunk and header of the binary chunk, which is followed by the binary and padding to 4 bytes.
+// The first buffer must not have an uri. Returns nothing, if the GLB would exceed 4 GiB.
+std::string createGlbHeader(const nlohmann::json& glTF, std::size_t binaryByteLength);
+
+// Saves the binary split by splitBuffers into the output directory, followed by the glTF referencing them. Buffer uris
+// are relative to the glTF, so only the saved files are prefixed by the directory. Additional buffers are added to outputs.
+bool saveGltf(nlohmann::json& glTF, const std::string& binary, std::size_t maxBufferSize, const std::string& outputDirectory, const std::string& uri, const std::string& savenameJson, std::vector<std::string>& outputs);
+
+#endif /*GLTF_GLTF_H*/
@@ -0,0 +1,146 @@
+#include "hash.h"
+
+#include <cstring>
+#include <vector>
+
+#include "parallel.h"
+
+constexpr std::uint64_t prime1{0x9E3779B185EBCA87ull};
+constexpr std::uint64_t prime2{0xC2B2AE3D27D4EB4Full};
+constexpr std::uint64_t prime3{0x165667B19E3779F9ull};
+constexpr std::uint64_t prime4{0x85EBCA77C2B2AE63ull};
+constexpr std::uint64_t prime5{0x27D4EB2F165667C5ull};
+
+// Size of the chunks hashed on their own by hashParallel.
+constexpr std::size_t chunkSize{4u * 1024u * 1024u};
+
+static std::uint64_t rotateLeft(std::uint64_t value, std::uint32_t bits)
+{
+    return (value << bits) | (value >> (64u - bits));
+}
+
+static std::uint64_t read64(const std::uint8_t* data)
+{
+    std::uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+
+    return value;
+}
+
+static std::uint32_t read32(const std::uint8_t* data)
+{
+    std::uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+
+    return value;
+}
+
+static std::uint64_t hashRound(std::uint64_t accumulator, std::uint64_t input)
+{
+    accumulator += input * prime2;
+    accumulator = rotateLeft(accumulator, 31u);
+    accumulator *= prime1;
+
+    return accumulator;
+}
+
+static std::uint64_t mergeRound(std::uint64_t accumulator, std::uint64_t value)
+{
+    accumulator ^= hashRound(0u, value);
+    accumulator = accumulator * prime1 + prime4;
+
+    return accumulator;
+}
+
+std::uint64_t hashXXH64(const void* data, std::size_t size, std::uint64_t seed)
+{
+    const std::uint8_t* current = static_cast<const std::uint8_t*>(data);
+    const std::uint8_t* end = current + size;
+
+    std::uint64_t hash;
+
+    if (size >= 32u)
+    {
+        std::uint64_t v1 = seed + prime1 + prime2;
+        std::uint64_t v2 = seed + prime2;
+        std::uint64_t v3 = seed;
+        std::uint64_t v4 = seed - prime1;
+
+        // Four independent lanes, so the loop is limited by memory bandwidth.
+        const std::uint8_t* limit = end - 32u;
+        do
+        {
+            v1 = hashRound(v1, read64(current));
+            v2 = hashRound(v2, read64(current + 8u));
+            v3 = hashRound(v3, read64(current + 16u));
+            v4 = hashRound(v4, read64(current + 24u));
+
+            current += 32u;
+        } while (current <= limit);
+
+        hash = rotateLeft(v1, 1u) + rotateLeft(v2, 7u) + rotateLeft(v3, 12u) + rotateLeft(v4, 18u);
+        hash = mergeRound(hash, v1);
+        hash = mergeRound(hash, v2);
+        hash = mergeRound(hash, v3);
+        hash = mergeRound(hash, v4);
+    }
+    else
+    {
+        hash = seed + prime5;
+    }
+
+    hash += static_cast<std::uint64_t>(size);
+
+    while (current + 8u <= end)
+    {
+        hash ^= hashRound(0u, read64(current));
+        hash = rotateLeft(hash, 27u) * prime1 + prime4;
+
+        current += 8u;
+    }
+
+    if (current + 4u <= end)
+    {
+        hash ^= static_cast<std::uint64_t>(read32(current)) * prime1;
+        hash = rotateLeft(hash, 23u) * prime2 + prime3;
+
+        current += 4u;
+    }
+
+    while (current < end)
+    {
+        hash ^= static_cast<std::uint64_t>(*current) * prime5;
+        hash = rotateLeft(hash, 11u) * prime1;
+
+        current++;
+    }
+
+    // Avalanche
+    hash ^= hash >> 33u;
+    hash *= prime2;
+    hash ^= hash >> 29u;
+    hash *= prime3;
+    hash ^= hash >> 32u;
+
+    return hash;
+}
+
+std::uint64_t hashParallel(const void* data, std::size_t size, std::uint64_t seed)
+{
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+
+    const std::size_t chunkCount = (size + chunkSize - 1u) / chunkSize;
+
+    std::vector<std::uint64_t> hashes(chunkCount);
+
+    parallelFor(0u, chunkCount, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t chunk = begin; chunk < end; chunk++)
+        {
+            const std::size_t offset = chunk * chunkSize;
+
+            hashes[chunk] = hashXXH64(bytes + offset, std::min(chunkSize, size - offset), seed);
+        }
+    });
+
+    return hashXXH64(hashes.data(), hashes.size() * sizeof(std::uint64_t), seed ^ static_cast<std::uint64_t>(size));
+}
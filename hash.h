@@ -0,0 +1,13 @@
+#ifndef GLTF_HASH_H
+#define GLTF_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+// 64 bit xxHash of the given data.
+std::uint64_t hashXXH64(const void* data, std::size_t size, std::uint64_t seed);
+
+// Hashes fixed size chunks in parallel and combines the chunk hashes, so the result differs from hashXXH64 over the whole data.
+std::uint64_t hashParallel(const void* data, std::size_t size, std::uint64_t seed);
+
+#endif /*GLTF_HASH_H*/
@@ -0,0 +1,1006 @@
+#include "input.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#if defined(PLY2GLTF_ZLIB)
+#include <zlib.h>
+#endif
+
+#if defined(PLY2GLTF_ZSTD)
+#include <zstd.h>
+#endif
+
+#include "dump.h"
+#include "gltf.h"
+#include "io.h"
+#include "memory.h"
+#include "parallel.h"
+
+// Size of the chunks passed from the reader to the conversion.
+constexpr std::size_t chunkSize{4u * 1024u * 1024u};
+
+// Chunks in flight between reading and converting, which bounds the memory used for streaming.
+constexpr std::size_t queueCapacity{4u};
+
+// Converted chunks kept for reuse, so their pages do not have to be faulted in again.
+constexpr std::size_t recycleCapacity{16u};
+
+// Vertex ranges queued per converting worker.
+constexpr std::size_t tasksPerWorker{2u};
+
+// Converted ranges waiting to be written in order.
+constexpr std::size_t writeCapacity{64u};
+
+// Size of the reads from the input file.
+constexpr std::size_t readSize{1024u * 1024u};
+
+// A header larger than this is treated as missing.
+constexpr std::size_t maxHeaderSize{64u * 1024u};
+
+// Spherical harmonics degree 0 basis constant.
+constexpr float shC0{0.28209479177387814f};
+
+ChunkQueue::ChunkQueue(std::size_t capacity) :
+    chunks(capacity),
+    recycled(recycleCapacity)
+{
+}
+
+bool ChunkQueue::push(std::string chunk)
+{
+    return chunks.push(std::move(chunk));
+}
+
+bool ChunkQueue::pop(std::string& chunk)
+{
+    return chunks.pop(chunk);
+}
+
+void ChunkQueue::finish(bool failed)
+{
+    this->failed.store(failed, std::memory_order_release);
+    chunks.close();
+}
+
+void ChunkQueue::cancel()
+{
+    chunks.close();
+
+    std::string chunk{};
+    while (chunks.tryPop(chunk))
+    {
+    }
+}
+
+bool ChunkQueue::hasFailed()
+{
+    return failed.load(std::memory_order_acquire);
+}
+
+std::string ChunkQueue::acquire()
+{
+    std::string chunk{};
+    recycled.tryPop(chunk);
+    chunk.clear();
+
+    return chunk;
+}
+
+void ChunkQueue::recycle(std::string chunk)
+{
+    // Freed, if enough chunks are waiting for reuse.
+    recycled.tryPush(chunk);
+}
+
+QueueMetrics ChunkQueue::getMetrics() const
+{
+    return chunks.getMetrics();
+}
+
+// Collects written bytes into chunks of chunkSize before passing them to the queue.
+struct ChunkWriter
+{
+    ChunkQueue& queue;
+    std::string chunk{};
+
+    bool write(const char* data, std::size_t size)
+    {
+        while (size > 0u)
+        {
+            if (chunk.capacity() < chunkSize)
+            {
+                chunk = queue.acquire();
+                chunk.reserve(chunkSize);
+            }
+
+            const std::size_t length = std::min(size, chunkSize - chunk.size());
+            chunk.append(data, length);
+
+            data += length;
+            size -= length;
+
+            if (chunk.size() == chunkSize && !flush())
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool flush()
+    {
+        if (chunk.empty())
+        {
+            return true;
+        }
+
+        bool result = queue.push(std::move(chunk));
+        chunk = std::string{};
+
+        return result;
+    }
+};
+
+InputFormat getInputFormat(const std::string& filename)
+{
+    std::string name{filename};
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+
+    if (name.ends_with(".gz"))
+    {
+        return InputFormat::PLY_GZIP;
+    }
+    else if (name.ends_with(".zst"))
+    {
+        return InputFormat::PLY_ZSTD;
+    }
+    else if (name.ends_with(".splat"))
+    {
+        return InputFormat::SPLAT;
+    }
+    else if (name.ends_with(".spz"))
+    {
+        return InputFormat::SPZ;
+    }
+    else if (name.ends_with(".gltf"))
+    {
+        return InputFormat::GLTF;
+    }
+    else if (name.ends_with(".glb"))
+    {
+        return InputFormat::GLB;
+    }
+
+    return InputFormat::PLY;
+}
+
+bool isInputFormatSupported(InputFormat format)
+{
+    if (format == InputFormat::PLY_GZIP || format == InputFormat::SPZ)
+    {
+#if defined(PLY2GLTF_ZLIB)
+        return true;
+#else
+        return false;
+#endif
+    }
+    else if (format == InputFormat::PLY_ZSTD)
+    {
+#if defined(PLY2GLTF_ZSTD)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    return true;
+}
+
+#if defined(PLY2GLTF_ZLIB)
+
+// Inflates gzip or zlib data, also of concatenated gzip members, and passes the output to the sink.
+template <typename Sink>
+static bool inflateFile(std::istream& file, Sink sink)
+{
+    z_stream stream{};
+    // Automatic detection of the gzip or zlib header.
+    if (inflateInit2(&stream, 15 + 32) != Z_OK)
+    {
+        return false;
+    }
+
+    std::vector<char> input(readSize);
+    std::vector<char> output(readSize);
+
+    int result{Z_OK};
+    while (true)
+    {
+        if (stream.avail_in == 0u)
+        {
+            file.read(input.data(), input.size());
+            stream.avail_in = static_cast<uInt>(file.gcount());
+            stream.next_in = reinterpret_cast<Bytef*>(input.data());
+
+            if (stream.avail_in == 0u)
+            {
+                break;
+            }
+        }
+
+        stream.avail_out = static_cast<uInt>(output.size());
+        stream.next_out = reinterpret_cast<Bytef*>(output.data());
+
+        result = inflate(&stream, Z_NO_FLUSH);
+        if (result != Z_OK && result != Z_STREAM_END)
+        {
+            break;
+        }
+
+        if (!sink(output.data(), output.size() - stream.avail_out))
+        {
+            result = Z_STREAM_ERROR;
+
+            break;
+        }
+
+        if (result == Z_STREAM_END)
+        {
+            // Next gzip member can follow.
+            inflateReset(&stream);
+        }
+    }
+
+    inflateEnd(&stream);
+
+    return result == Z_OK || result == Z_STREAM_END;
+}
+
+#endif
+
+#if defined(PLY2GLTF_ZSTD)
+
+static bool decompressZstdFile(std::istream& file, ChunkWriter& writer)
+{
+    ZSTD_DStream* stream = ZSTD_createDStream();
+    if (!stream)
+    {
+        return false;
+    }
+
+    std::vector<char> input(ZSTD_DStreamInSize());
+    std::vector<char> output(ZSTD_DStreamOutSize());
+
+    bool success{true};
+    std::size_t result{0u};
+    while (success)
+    {
+        file.read(input.data(), input.size());
+        ZSTD_inBuffer inBuffer{input.data(), static_cast<std::size_t>(file.gcount()), 0u};
+        if (inBuffer.size == 0u)
+        {
+            break;
+        }
+
+        while (inBuffer.pos < inBuffer.size)
+        {
+            ZSTD_outBuffer outBuffer{output.data(), output.size(), 0u};
+
+            result = ZSTD_decompressStream(stream, &outBuffer, &inBuffer);
+            if (ZSTD_isError(result) || !writer.write(output.data(), outBuffer.pos))
+            {
+                success = false;
+
+                break;
+            }
+        }
+    }
+
+    ZSTD_freeDStream(stream);
+
+    // Non zero result means the last frame is incomplete.
+    return success && result == 0u;
+}
+
+#endif
+
+static float inverseSigmoid(float value)
+{
+    // Fully transparent or opaque values would be infinite.
+    value = std::clamp(value, 0.5f / 255.0f, 1.0f - 0.5f / 255.0f);
+
+    return std::log(value / (1.0f - value));
+}
+
+// Decodes antimatter15 .splat records of 32 bytes: Position and linear scale as floats, RGBA and rotation as bytes.
+static bool decodeSplatFile(std::istream& file, ChunkWriter& writer)
+{
+    constexpr std::size_t recordSize{32u};
+
+    file.seekg(0, std::ios::end);
+    const std::size_t fileSize = static_cast<std::size_t>(file.tellg());
+    file.seekg(0);
+
+    if (fileSize == 0u || fileSize % recordSize != 0u)
+    {
+        printf("Error: Size of .splat file is not a multiple of %zu bytes\n", recordSize);
+
+        return false;
+    }
+
+    const std::uint32_t count = static_cast<std::uint32_t>(fileSize / recordSize);
+
+    const std::string header = createPlyHeader(count, 0u);
+    if (!writer.write(header.data(), header.size()))
+    {
+        return false;
+    }
+
+    std::vector<char> input(readSize / recordSize * recordSize);
+    std::vector<float> output{};
+
+    while (true)
+    {
+        file.read(input.data(), input.size());
+        const std::size_t records = static_cast<std::size_t>(file.gcount()) / recordSize;
+        if (records == 0u)
+        {
+            break;
+        }
+
+        output.clear();
+        for (std::size_t i = 0u; i < records; i++)
+        {
+            const char* record = input.data() + i * recordSize;
+
+            float position[3];
+            float scale[3];
+            std::memcpy(position, record, sizeof(position));
+            std::memcpy(scale, record + 12u, sizeof(scale));
+
+            const std::uint8_t* color = reinterpret_cast<const std::uint8_t*>(record + 24u);
+            const std::uint8_t* rotation = reinterpret_cast<const std::uint8_t*>(record + 28u);
+
+            // Same property order as written by createPlyHeader.
+            output.insert(output.end(), {position[0u], position[1u], position[2u]});
+            for (std::uint32_t j = 0u; j < 4u; j++)
+            {
+                // Stored as w, x, y and z like in PLY.
+                output.push_back((static_cast<float>(rotation[j]) - 128.0f) / 128.0f);
+            }
+            for (std::uint32_t j = 0u; j < 3u; j++)
+            {
+                output.push_back(std::log(std::max(scale[j], 1e-30f)));
+            }
+            output.push_back(inverseSigmoid(static_cast<float>(color[3u]) / 255.0f));
+            for (std::uint32_t j = 0u; j < 3u; j++)
+            {
+                output.push_back((static_cast<float>(color[j]) / 255.0f - 0.5f) / shC0);
+            }
+        }
+
+        if (!writer.write(reinterpret_cast<const char*>(output.data()), output.size() * sizeof(float)))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+#if defined(PLY2GLTF_ZLIB)
+
+// Decodes Niantic .spz, which stores all attributes column by column in right-up-back coordinates.
+// As the columns are needed at once, the inflated data is kept in memory, which is about a tenth of the PLY size.
+static bool decodeSpzFile(std::istream& file, ChunkWriter& writer)
+{
+    std::string data{};
+    if (!inflateFile(file, [&](const char* output, std::size_t size) {
+            data.append(output, size);
+
+            return true;
+        }))
+    {
+        printf("Error: Could not inflate .spz file\n");
+
+        return false;
+    }
+
+    constexpr std::uint32_t magic{0x5053474eu};
+    constexpr std::size_t headerSize{16u};
+
+    std::uint32_t header[3u]{};
+    if (data.size() < headerSize)
+    {
+        printf("Error: Invalid .spz header\n");
+
+        return false;
+    }
+    std::memcpy(header, data.data(), sizeof(header));
+
+    const std::uint32_t version{header[1u]};
+    const std::uint32_t count{header[2u]};
+    const std::uint32_t degree = static_cast<std::uint8_t>(data[12u]);
+    const std::uint32_t fractionalBits = static_cast<std::uint8_t>(data[13u]);
+
+    if (header[0u] != magic || version < 2u || version > 3u || degree > 3u || count == 0u)
+    {
+        printf("Error: Unsupported .spz version %u or degree %u\n", version, degree);
+
+        return false;
+    }
+
+    const std::uint32_t shCoefficients = degree == 0u ? 0u : (degree + 1u) * (degree + 1u) - 1u;
+    const std::size_t rotationSize = version >= 3u ? 4u : 3u;
+
+    const std::size_t positionsOffset{headerSize};
+    const std::size_t alphasOffset = positionsOffset + static_cast<std::size_t>(count) * 9u;
+    const std::size_t colorsOffset = alphasOffset + count;
+    const std::size_t scalesOffset = colorsOffset + static_cast<std::size_t>(count) * 3u;
+    const std::size_t rotationsOffset = scalesOffset + static_cast<std::size_t>(count) * 3u;
+    const std::size_t shOffset = rotationsOffset + static_cast<std::size_t>(count) * rotationSize;
+    const std::size_t endOffset = shOffset + static_cast<std::size_t>(count) * shCoefficients * 3u;
+
+    if (data.size() < endOffset)
+    {
+        printf("Error: Truncated .spz file\n");
+
+        return false;
+    }
+
+    const std::uint8_t* bytes = reinterpret_cast<const std::uint8_t*>(data.data());
+
+    // Sign of the coefficients, when rotating 180 degree around the x-axis from right-up-back to right-down-front as used in PLY.
+    constexpr float shFlip[15u]{-1.0f, -1.0f, 1.0f, -1.0f, 1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, -1.0f, 1.0f};
+
+    const std::string plyHeader = createPlyHeader(count, degree);
+    if (!writer.write(plyHeader.data(), plyHeader.size()))
+    {
+        return false;
+    }
+
+    const float positionScale = 1.0f / static_cast<float>(1u << fractionalBits);
+
+    std::vector<float> output{};
+    for (std::uint32_t vertex = 0u; vertex < count; vertex++)
+    {
+        // POSITION as 24 bit signed fixed point.
+        float position[3];
+        for (std::uint32_t j = 0u; j < 3u; j++)
+        {
+            const std::uint8_t* p = bytes + positionsOffset + (static_cast<std::size_t>(vertex) * 3u + j) * 3u;
+
+            std::int32_t value = static_cast<std::int32_t>(p[0u] | (p[1u] << 8u) | (p[2u] << 16u));
+            if (value & 0x800000)
+            {
+                value -= 0x1000000;
+            }
+
+            position[j] = static_cast<float>(value) * positionScale;
+        }
+        output.insert(output.end(), {position[0u], -position[1u], -position[2u]});
+
+        // ROTATION, Indices: 0=x, 1=y, 2=z, 3=w
+        float q[4u]{};
+        const std::uint8_t* r = bytes + rotationsOffset + static_cast<std::size_t>(vertex) * rotationSize;
+        if (version >= 3u)
+        {
+            // Smallest three: Index of the largest component and three times 9 bit magnitude plus sign bit.
+            std::uint32_t compressed = r[0u] | (r[1u] << 8u) | (r[2u] << 16u) | (static_cast<std::uint32_t>(r[3u]) << 24u);
+            const std::uint32_t largest = compressed >> 30u;
+            constexpr std::uint32_t mask{(1u << 9u) - 1u};
+
+            float sumSquares{0.0f};
+            for (std::int32_t i = 3; i >= 0; i--)
+            {
+                if (static_cast<std::uint32_t>(i) == largest)
+                {
+                    continue;
+                }
+
+                const std::uint32_t magnitude = compressed & mask;
+                const bool negative = ((compressed >> 9u) & 1u) != 0u;
+                compressed >>= 10u;
+
+                q[i] = 0.70710678f * static_cast<float>(magnitude) / static_cast<float>(mask);
+                if (negative)
+                {
+                    q[i] = -q[i];
+                }
+                sumSquares += q[i] * q[i];
+            }
+            q[largest] = std::sqrt(std::max(0.0f, 1.0f - sumSquares));
+        }
+        else
+        {
+            for (std::uint32_t j = 0u; j < 3u; j++)
+            {
+                q[j] = static_cast<float>(r[j]) / 127.5f - 1.0f;
+            }
+            q[3u] = std::sqrt(std::max(0.0f, 1.0f - q[0u] * q[0u] - q[1u] * q[1u] - q[2u] * q[2u]));
+        }
+        // Written as w, x, y and z like in PLY.
+        output.insert(output.end(), {q[3u], q[0u], -q[1u], -q[2u]});
+
+        // SCALE in log space.
+        for (std::uint32_t j = 0u; j < 3u; j++)
+        {
+            output.push_back(static_cast<float>(bytes[scalesOffset + static_cast<std::size_t>(vertex) * 3u + j]) / 16.0f - 10.0f);
+        }
+
+        // OPACITY
+        output.push_back(inverseSigmoid(static_cast<float>(bytes[alphasOffset + vertex]) / 255.0f));
+
+        // SH_DEGREE_0_COEF_0
+        for (std::uint32_t j = 0u; j < 3u; j++)
+        {
+            output.push_back((static_cast<float>(bytes[colorsOffset + static_cast<std::size_t>(vertex) * 3u + j]) / 255.0f - 0.5f) / 0.15f);
+        }
+
+        // Higher degrees are interleaved by coefficient in .spz, however sorted by channel in PLY.
+        for (std::uint32_t channel = 0u; channel < 3u; channel++)
+        {
+            for (std::uint32_t j = 0u; j < shCoefficients; j++)
+            {
+                const std::uint8_t value = bytes[shOffset + (static_cast<std::size_t>(vertex) * shCoefficients + j) * 3u + channel];
+
+                output.push_back(shFlip[j] * (static_cast<float>(value) - 128.0f) / 128.0f);
+            }
+        }
+
+        if (output.size() * sizeof(float) >= chunkSize || vertex + 1u == count)
+        {
+            if (!writer.write(reinterpret_cast<const char*>(output.data()), output.size() * sizeof(float)))
+            {
+                return false;
+            }
+
+            output.clear();
+        }
+    }
+
+    return true;
+}
+
+#endif
+
+static void readInput(const std::string& filename, InputFormat format, ChunkQueue& queue)
+{
+    ChunkWriter writer{queue};
+
+    // '-' is reading from stdin, which is not seekable.
+    std::ifstream inputFile{};
+    if (filename != "-")
+    {
+        inputFile.open(filename, std::ios::binary);
+        if (!inputFile.is_open())
+        {
+            printf("Error: Could not load '%s'\n", filename.c_str());
+
+            queue.finish(true);
+
+            return;
+        }
+    }
+
+    std::istream& file = filename == "-" ? std::cin : inputFile;
+
+    bool success{false};
+    if (format == InputFormat::PLY)
+    {
+        // Read directly into the chunks, as there is nothing to decode.
+        success = true;
+        while (success)
+        {
+            std::string chunk = queue.acquire();
+            chunk.resize(chunkSize);
+
+            file.read(chunk.data(), chunk.size());
+            if (file.gcount() == 0)
+            {
+                break;
+            }
+            chunk.resize(static_cast<std::size_t>(file.gcount()));
+
+            success = queue.push(std::move(chunk));
+        }
+    }
+#if defined(PLY2GLTF_ZLIB)
+    else if (format == InputFormat::PLY_GZIP)
+    {
+        success = inflateFile(file, [&](const char* output, std::size_t size) {
+            return writer.write(output, size);
+        });
+    }
+    else if (format == InputFormat::SPZ)
+    {
+        success = decodeSpzFile(file, writer);
+    }
+#endif
+#if defined(PLY2GLTF_ZSTD)
+    else if (format == InputFormat::PLY_ZSTD)
+    {
+        success = decompressZstdFile(file, writer);
+    }
+#endif
+    else if (format == InputFormat::SPLAT)
+    {
+        success = decodeSplatFile(file, writer);
+    }
+
+    if (success)
+    {
+        success = writer.flush();
+    }
+
+    queue.finish(!success);
+}
+
+// Vertices of a chunk, which are converted by one of the workers.
+struct ConvertTask
+{
+    std::string chunk{};
+    std::size_t offset{0u};
+    std::uint32_t vertex{0u};
+    std::uint32_t count{0u};
+};
+
+// Converted vertices, which can be written.
+struct WriteRange
+{
+    std::uint32_t vertex{0u};
+    std::uint32_t count{0u};
+};
+
+// Writes the converted ranges in vertex order, as soon as all vertices before them have been converted. Keeps taking ranges
+// after a failure, so the workers do not block.
+static bool writeRanges(BoundedQueue<WriteRange>& ranges, const std::string& savename, const std::string& binary, std::uint32_t count, std::uint32_t byteStride)
+{
+    // Removing first does not write through hardlinks, e.g. from the conversion cache.
+    std::error_code errorCode{};
+    std::filesystem::remove(savename, errorCode);
+
+    std::ofstream file(savename, std::ios::binary);
+    bool success = file.is_open();
+
+    std::map<std::uint32_t, std::uint32_t> pending{};
+    std::uint32_t written{0u};
+
+    WriteRange range{};
+    while (ranges.pop(range))
+    {
+        pending[range.vertex] = range.count;
+
+        for (auto next = pending.begin(); next != pending.end() && next->first == written; next = pending.erase(next))
+        {
+            if (success)
+            {
+                success = static_cast<bool>(file.write(binary.data() + static_cast<std::size_t>(byteStride) * written, static_cast<std::streamsize>(static_cast<std::size_t>(byteStride) * next->second)));
+            }
+
+            written += next->second;
+        }
+    }
+
+    file.close();
+
+    return success && written == count && !file.fail();
+}
+
+// Splits the chunks into whole vertices as soon as they arrive, which are converted by work stealing workers. A vertex split
+// between chunks is completed and converted first. Converted vertices are written to savenameBinary in parallel, if given.
+static bool convertChunks(ChunkQueue& queue, bool convert, const std::string& savenameBinary, std::size_t maxBufferSize, PlyHeader& header, std::string& binary, PipelineStats& stats)
+{
+    std::string pending{};
+    std::string chunk{};
+
+    bool hasHeader{false};
+    std::uint32_t byteStride{0u};
+    std::uint32_t vertex{0u};
+
+    std::atomic<bool> failed{false};
+    std::atomic<std::uint64_t> convertAllocations{0u};
+
+    BoundedQueue<WriteRange> ranges{writeCapacity};
+    std::thread writer{};
+    bool writing{false};
+    bool written{false};
+
+    WorkStealingPool<ConvertTask> pool(getThreadCount(), tasksPerWorker, [&](ConvertTask& task) {
+        const std::uint64_t allocations = getThreadAllocationCount();
+
+        if (!convertPly(task.chunk.data() + task.offset, task.count, header, convert, binary.data() + static_cast<std::size_t>(byteStride) * task.vertex))
+        {
+            failed = true;
+        }
+
+        convertAllocations += getThreadAllocationCount() - allocations;
+
+        queue.recycle(std::move(task.chunk));
+
+        if (writing)
+        {
+            ranges.push(WriteRange{task.vertex, task.count});
+        }
+    });
+
+    bool success{true};
+    while (success && queue.pop(chunk))
+    {
+        if (!hasHeader)
+        {
+            pending += chunk;
+
+            if (pending.find("end_header\n") == std::string::npos)
+            {
+                if (pending.size() > maxHeaderSize)
+                {
+                    printf("Error: No header found\n");
+
+                    success = false;
+                }
+
+                continue;
+            }
+
+            printf("Info: Parsing PLY header\n");
+
+            if (!parsePlyHeader(pending, header))
+            {
+                success = false;
+
+                continue;
+            }
+
+            byteStride = getByteStride(header.degree);
+            binary.resize(static_cast<std::size_t>(byteStride) * header.count);
+
+            chunk = pending.substr(header.byteLength);
+            pending.clear();
+
+            hasHeader = true;
+
+            // Split buffers are saved afterwards.
+            if (!savenameBinary.empty() && binary.size() <= maxBufferSize)
+            {
+                writing = true;
+                writer = std::thread([&]() {
+                    written = writeRanges(ranges, savenameBinary, binary, header.count, byteStride);
+                });
+            }
+
+            printf("Info: Processing PLY binary data\n");
+        }
+
+        std::size_t offset{0u};
+
+        if (!pending.empty())
+        {
+            const std::size_t length = std::min<std::size_t>(header.sourceByteStride - pending.size(), chunk.size());
+            pending.append(chunk, 0u, length);
+            offset = length;
+
+            if (pending.size() < header.sourceByteStride)
+            {
+                continue;
+            }
+
+            if (vertex < header.count)
+            {
+                if (!convertPly(pending.data(), 1u, header, convert, binary.data() + static_cast<std::size_t>(byteStride) * vertex))
+                {
+                    success = false;
+
+                    continue;
+                }
+
+                if (writing)
+                {
+                    ranges.push(WriteRange{vertex, 1u});
+                }
+            }
+
+            vertex++;
+            pending.clear();
+        }
+
+        if (vertex >= header.count)
+        {
+            // Trailing data e.g. of further elements is ignored.
+            queue.recycle(std::move(chunk));
+
+            continue;
+        }
+
+        const std::uint32_t vertices = static_cast<std::uint32_t>(std::min<std::size_t>((chunk.size() - offset) / header.sourceByteStride, header.count - vertex));
+        const std::size_t end = offset + static_cast<std::size_t>(vertices) * header.sourceByteStride;
+
+        if (vertex + vertices < header.count)
+        {
+            pending.assign(chunk, end);
+        }
+
+        if (vertices > 0u)
+        {
+            pool.submit(ConvertTask{std::move(chunk), offset, vertex, vertices});
+        }
+        else
+        {
+            queue.recycle(std::move(chunk));
+        }
+
+        vertex += vertices;
+    }
+
+    pool.finish();
+
+    ranges.close();
+    if (writer.joinable())
+    {
+        writer.join();
+    }
+
+    stats.read = queue.getMetrics();
+    stats.convert = pool.getMetrics();
+    stats.write = ranges.getMetrics();
+    stats.workers = pool.getWorkerCount();
+    stats.steals = pool.getSteals();
+    stats.convertAllocations = convertAllocations;
+    stats.binaryWritten = written;
+
+    if (!success || failed)
+    {
+        return false;
+    }
+
+    if (!hasHeader || vertex < header.count)
+    {
+        printf("Error: Unexpected end of data\n");
+
+        return false;
+    }
+
+    return true;
+}
+
+bool streamInput(const std::string& filename, InputFormat format, bool convert, const std::string& savenameBinary, std::size_t maxBufferSize, PlyHeader& header, std::string& binary, PipelineStats& stats)
+{
+    ChunkQueue queue{queueCapacity};
+
+    std::thread reader(readInput, std::cref(filename), format, std::ref(queue));
+
+    bool success = convertChunks(queue, convert, savenameBinary, maxBufferSize, header, binary, stats);
+    if (!success)
+    {
+        queue.cancel();
+    }
+
+    reader.join();
+
+    return success && !queue.hasFailed();
+}
+
+bool readInputHeader(const std::string& filename, InputFormat format, PlyHeader& header)
+{
+    std::string pending{};
+
+    if (format == InputFormat::PLY)
+    {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.is_open())
+        {
+            printf("Error: Could not load '%s'\n", filename.c_str());
+
+            return false;
+        }
+
+        pending.resize(maxHeaderSize);
+        file.read(pending.data(), pending.size());
+        pending.resize(static_cast<std::size_t>(file.gcount()));
+
+        return parsePlyHeader(pending, header);
+    }
+
+    // Other formats are decoded until the header is complete.
+    ChunkQueue queue{queueCapacity};
+
+    std::thread reader(readInput, std::cref(filename), format, std::ref(queue));
+
+    std::string chunk{};
+    while (pending.find("end_header\n") == std::string::npos && pending.size() <= maxHeaderSize && queue.pop(chunk))
+    {
+        pending += chunk;
+    }
+
+    queue.cancel();
+
+    reader.join();
+
+    return parsePlyHeader(pending, header);
+}
+
+bool loadInput(const std::string& filename, InputFormat format, bool convert, std::string& input, PlyHeader& header, std::string& binary, std::uint64_t& convertAllocations)
+{
+    binary.clear();
+
+    if (format != InputFormat::PLY || filename == "-")
+    {
+        // Decompressing or decoding on a separate thread, while converting the already available data.
+        printf("Info: Streaming '%s' ...\n", filename.c_str());
+
+        PipelineStats stats{};
+        if (!streamInput(filename, format, convert, {}, 0u, header, binary, stats))
+        {
+            printf("Error: Can not process `%s` file\n", filename.c_str());
+
+            return false;
+        }
+
+        convertAllocations = stats.convertAllocations;
+
+        printf("Info: Streamed '%s'\n", filename.c_str());
+
+        return true;
+    }
+
+    printf("Info: Loading '%s' ...\n", filename.c_str());
+
+    if (!loadFile(filename, input) || input.empty())
+    {
+        printf("Error: Could not load '%s'\n", filename.c_str());
+
+        return false;
+    }
+
+    printf("Info: Loaded '%s'\n", filename.c_str());
+
+    //
+    // Processing PLY header and binary data.
+    //
+
+    printf("Info: Parsing PLY header\n");
+
+    if (!parsePlyHeader(input, header))
+    {
+        printf("Error: Can not process `%s` file\n", filename.c_str());
+
+        return false;
+    }
+
+    if (input.size() - header.byteLength < static_cast<std::size_t>(header.sourceByteStride) * header.count)
+    {
+        printf("Error: `%s` file is truncated\n", filename.c_str());
+
+        return false;
+    }
+
+    // Final buffer size can be calculated.
+    binary.resize(static_cast<std::size_t>(getByteStride(header.degree)) * header.count);
+
+    printf("Info: Processing PLY binary data\n");
+
+    const std::uint64_t allocations = getThreadAllocationCount();
+
+    if (!convertPly(input.data() + header.byteLength, header.count, header, convert, binary.data()))
+    {
+        return false;
+    }
+
+    convertAllocations = getThreadAllocationCount() - allocations;
+
+    return true;
+}
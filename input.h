@@ -0,0 +1,74 @@
+#ifndef GLTF_INPUT_H
+#define GLTF_INPUT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "pipeline.h"
+#include "ply.h"
+
+enum class InputFormat {
+    PLY,
+    PLY_GZIP,
+    PLY_ZSTD,
+    SPLAT,
+    SPZ,
+    // glTF assets with KHR_gaussian_splatting, which are decoded back to PLY.
+    GLTF,
+    GLB,
+};
+
+// Bounded queue of byte chunks from a producing to a consuming thread. Memory of consumed chunks is handed back for reuse.
+class ChunkQueue
+{
+public:
+    explicit ChunkQueue(std::size_t capacity);
+
+    // Blocks while the queue is full. Returns false, if the consumer cancelled.
+    bool push(std::string chunk);
+
+    // Blocks while the queue is empty. Returns false, after the last chunk has been consumed.
+    bool pop(std::string& chunk);
+
+    // Called by the producer after the last chunk.
+    void finish(bool failed);
+
+    // Called by the consumer, so the producer stops.
+    void cancel();
+
+    bool hasFailed();
+
+    // Empty chunk, with the memory of a recycled one if available.
+    std::string acquire();
+
+    void recycle(std::string chunk);
+
+    QueueMetrics getMetrics() const;
+
+private:
+    BoundedQueue<std::string> chunks;
+    BoundedQueue<std::string> recycled;
+    std::atomic<bool> failed{false};
+};
+
+// Detects the format by the file extension.
+InputFormat getInputFormat(const std::string& filename);
+
+// Returns false, if the format is not available in this build.
+bool isInputFormatSupported(InputFormat format);
+
+// Reads, decompresses or decodes the file, or stdin for '-', on a separate thread into chunks of PLY data, whose vertices are
+// converted by work stealing workers while streaming in. If savenameBinary is not empty and the records fit into maxBufferSize,
+// they are also written to it in order on a further thread. Queue depths between the stages are collected in stats.
+bool streamInput(const std::string& filename, InputFormat format, bool convert, const std::string& savenameBinary, std::size_t maxBufferSize, PlyHeader& header, std::string& binary, PipelineStats& stats);
+
+// Parses only the PLY header of the file, decoding just as much of other formats as needed.
+bool readInputHeader(const std::string& filename, InputFormat format, PlyHeader& header);
+
+// Loads a binary PLY into input and converts it, or streams any other format, into the interleaved records in binary.
+// Heap allocations while converting the loaded PLY are counted in convertAllocations.
+bool loadInput(const std::string& filename, InputFormat format, bool convert, std::string& input, PlyHeader& header, std::string& binary, std::uint64_t& convertAllocations);
+
+#endif /*GLTF_INPUT_H*/
@@ -0,0 +1,313 @@
+#include "inspect.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "input.h"
+#include "io.h"
+#include "parallel.h"
+#include "ply.h"
+
+using json = nlohmann::json;
+
+constexpr std::uint32_t histogramBins{32u};
+
+// Index of the scalars gathered per splat: position, log scale, raw opacity, quaternion norm and magnitude per band.
+constexpr std::uint32_t positionIndex{0u};
+constexpr std::uint32_t scaleIndex{3u};
+constexpr std::uint32_t opacityIndex{6u};
+constexpr std::uint32_t normIndex{7u};
+constexpr std::uint32_t bandIndex{8u};
+constexpr std::uint32_t maxStatistics{bandIndex + 4u};
+
+struct Statistic
+{
+    float min{std::numeric_limits<float>::max()};
+    float max{std::numeric_limits<float>::lowest()};
+    double sum{0.0};
+    std::uint64_t count{0u};
+    std::uint64_t histogram[histogramBins]{};
+};
+
+struct Inspection
+{
+    Statistic statistics[maxStatistics]{};
+
+    std::uint64_t nanValues{0u};
+    std::uint64_t infiniteValues{0u};
+    // Quaternions of zero length, which abort the conversion.
+    std::uint64_t zeroQuaternions{0u};
+    // Splats with any of the above.
+    std::uint64_t invalidSplats{0u};
+};
+
+// Gathers the scalars of one vertex and counts its non-finite values. Derived scalars of these are not finite either.
+static void getValues(const char* vertex, const std::uint32_t sourceByteOffsets[], std::uint32_t degree, float values[], Inspection& inspection)
+{
+    const float* position = reinterpret_cast<const float*>(vertex + sourceByteOffsets[POSITION]);
+    const float* rotation = reinterpret_cast<const float*>(vertex + sourceByteOffsets[ROTATION]);
+    const float* scale = reinterpret_cast<const float*>(vertex + sourceByteOffsets[SCALE]);
+    const float* opacity = reinterpret_cast<const float*>(vertex + sourceByteOffsets[OPACITY]);
+    const float* color = reinterpret_cast<const float*>(vertex + sourceByteOffsets[SH_DEGREE_0_COEF_0]);
+    const float* higher = reinterpret_cast<const float*>(vertex + sourceByteOffsets[SH_DEGREE_HIGHER]);
+
+    const std::uint32_t coefficients = (degree + 1u) * (degree + 1u) - 1u;
+
+    bool invalid{false};
+    const auto check = [&](const float* data, std::uint32_t count) {
+        for (std::uint32_t i = 0u; i < count; i++)
+        {
+            if (std::isnan(data[i]))
+            {
+                inspection.nanValues++;
+                invalid = true;
+            }
+            else if (std::isinf(data[i]))
+            {
+                inspection.infiniteValues++;
+                invalid = true;
+            }
+        }
+    };
+
+    check(position, 3u);
+    check(rotation, 4u);
+    check(scale, 3u);
+    check(opacity, 1u);
+    check(color, 3u);
+    check(higher, 3u * coefficients);
+
+    for (std::uint32_t i = 0u; i < 3u; i++)
+    {
+        values[positionIndex + i] = position[i];
+        values[scaleIndex + i] = scale[i];
+    }
+    values[opacityIndex] = *opacity;
+
+    // Same as the normalization of convertPly.
+    values[normIndex] = std::sqrt(rotation[0u] * rotation[0u] + rotation[1u] * rotation[1u] + rotation[2u] * rotation[2u] + rotation[3u] * rotation[3u]);
+    if (values[normIndex] == 0.0f)
+    {
+        inspection.zeroQuaternions++;
+        invalid = true;
+    }
+
+    values[bandIndex] = std::sqrt(color[0u] * color[0u] + color[1u] * color[1u] + color[2u] * color[2u]);
+
+    // Higher degrees are sorted by channel in PLY, band b holding the coefficients b * b - 1 to (b + 1) * (b + 1) - 2.
+    float squares[4u]{};
+    for (std::uint32_t channel = 0u; channel < 3u; channel++)
+    {
+        for (std::uint32_t band = 1u; band <= degree; band++)
+        {
+            for (std::uint32_t j = band * band - 1u; j < (band + 1u) * (band + 1u) - 1u; j++)
+            {
+                const float value = higher[channel * coefficients + j];
+                squares[band] += value * value;
+            }
+        }
+    }
+    for (std::uint32_t band = 1u; band <= degree; band++)
+    {
+        values[bandIndex + band] = std::sqrt(squares[band]);
+    }
+
+    if (invalid)
+    {
+        inspection.invalidSplats++;
+    }
+}
+
+static std::uint32_t getBin(const Statistic& statistic, float value)
+{
+    // In double, as the range of finite floats can overflow.
+    const double range = static_cast<double>(statistic.max) - static_cast<double>(statistic.min);
+    if (range <= 0.0)
+    {
+        return 0u;
+    }
+
+    return std::min(static_cast<std::uint32_t>((static_cast<double>(value) - static_cast<double>(statistic.min)) / range * histogramBins), histogramBins - 1u);
+}
+
+static json getStatistic(const Statistic& statistic)
+{
+    json result = json::object();
+    if (statistic.count == 0u)
+    {
+        result["min"] = nullptr;
+        result["max"] = nullptr;
+        result["mean"] = nullptr;
+    }
+    else
+    {
+        result["min"] = statistic.min;
+        result["max"] = statistic.max;
+        result["mean"] = statistic.sum / static_cast<double>(statistic.count);
+    }
+    result["histogram"] = std::vector<std::uint64_t>(statistic.histogram, statistic.histogram + histogramBins);
+
+    return result;
+}
+
+bool inspectInput(const std::string& filename)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    if (filename == "-" || getInputFormat(filename) != InputFormat::PLY)
+    {
+        printf("Error: --inspect requires a binary PLY file\n");
+
+        return false;
+    }
+
+    PlyHeader header{};
+    if (!readInputHeader(filename, InputFormat::PLY, header))
+    {
+        printf("Error: Can not process `%s` file\n", filename.c_str());
+
+        return false;
+    }
+
+    MappedFile mappedFile{};
+    if (!mapFile(filename, mappedFile))
+    {
+        printf("Error: Could not load '%s'\n", filename.c_str());
+
+        return false;
+    }
+
+    if (mappedFile.size - header.byteLength < static_cast<std::size_t>(header.sourceByteStride) * header.count)
+    {
+        printf("Error: `%s` file is truncated\n", filename.c_str());
+
+        return false;
+    }
+
+    const std::uint32_t degree{header.degree};
+    const std::uint32_t statisticCount = bandIndex + 1u + degree;
+    const std::size_t sourceByteStride{header.sourceByteStride};
+    const char* vertices = mappedFile.data + header.byteLength;
+
+    std::uint32_t sourceByteOffsets[SH_DEGREE_HIGHER + 1]{};
+    for (const auto& [attribute, sourceByteOffset] : header.sourceByteOffsets)
+    {
+        sourceByteOffsets[attribute] = sourceByteOffset;
+    }
+
+    //
+    // First pass for the ranges and anomalies, second pass for the histograms within these ranges.
+    //
+
+    Inspection inspection{};
+    std::mutex mutex{};
+
+    parallelFor(0u, header.count, [&](std::size_t begin, std::size_t end) {
+        Inspection local{};
+        float values[maxStatistics]{};
+
+        for (std::size_t vertex = begin; vertex < end; vertex++)
+        {
+            getValues(vertices + sourceByteStride * vertex, sourceByteOffsets, degree, values, local);
+
+            for (std::uint32_t i = 0u; i < statisticCount; i++)
+            {
+                if (std::isfinite(values[i]))
+                {
+                    Statistic& statistic = local.statistics[i];
+                    statistic.min = std::min(statistic.min, values[i]);
+                    statistic.max = std::max(statistic.max, values[i]);
+                    statistic.sum += values[i];
+                    statistic.count++;
+                }
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (std::uint32_t i = 0u; i < statisticCount; i++)
+        {
+            Statistic& statistic = inspection.statistics[i];
+            statistic.min = std::min(statistic.min, local.statistics[i].min);
+            statistic.max = std::max(statistic.max, local.statistics[i].max);
+            statistic.sum += local.statistics[i].sum;
+            statistic.count += local.statistics[i].count;
+        }
+        inspection.nanValues += local.nanValues;
+        inspection.infiniteValues += local.infiniteValues;
+        inspection.zeroQuaternions += local.zeroQuaternions;
+        inspection.invalidSplats += local.invalidSplats;
+    });
+
+    parallelFor(0u, header.count, [&](std::size_t begin, std::size_t end) {
+        Inspection local{};
+        float values[maxStatistics]{};
+
+        for (std::size_t vertex = begin; vertex < end; vertex++)
+        {
+            getValues(vertices + sourceByteStride * vertex, sourceByteOffsets, degree, values, local);
+
+            for (std::uint32_t i = 0u; i < statisticCount; i++)
+            {
+                if (std::isfinite(values[i]))
+                {
+                    local.statistics[i].histogram[getBin(inspection.statistics[i], values[i])]++;
+                }
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (std::uint32_t i = 0u; i < statisticCount; i++)
+        {
+            for (std::uint32_t bin = 0u; bin < histogramBins; bin++)
+            {
+                inspection.statistics[i].histogram[bin] += local.statistics[i].histogram[bin];
+            }
+        }
+    });
+
+    //
+
+    json report = json::object();
+    report["filename"] = filename;
+    report["inputBytes"] = mappedFile.size;
+    report["count"] = header.count;
+    report["degree"] = degree;
+    report["sourceByteStride"] = header.sourceByteStride;
+    report["histogramBins"] = histogramBins;
+
+    report["position"] = json::array();
+    report["logScale"] = json::array();
+    for (std::uint32_t i = 0u; i < 3u; i++)
+    {
+        report["position"].push_back(getStatistic(inspection.statistics[positionIndex + i]));
+        report["logScale"].push_back(getStatistic(inspection.statistics[scaleIndex + i]));
+    }
+    // Before the sigmoid.
+    report["opacity"] = getStatistic(inspection.statistics[opacityIndex]);
+    report["quaternionNorm"] = getStatistic(inspection.statistics[normIndex]);
+    report["shBandMagnitude"] = json::array();
+    for (std::uint32_t band = 0u; band <= degree; band++)
+    {
+        report["shBandMagnitude"].push_back(getStatistic(inspection.statistics[bandIndex + band]));
+    }
+
+    report["nanValues"] = inspection.nanValues;
+    report["infiniteValues"] = inspection.infiniteValues;
+    report["zeroQuaternions"] = inspection.zeroQuaternions;
+    report["invalidSplats"] = inspection.invalidSplats;
+
+    report["threads"] = getThreadCount();
+    report["milliseconds"] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%s\n", report.dump(4).c_str());
+
+    return true;
+}
@@ -0,0 +1,11 @@
+#ifndef GLTF_INSPECT_H
+#define GLTF_INSPECT_H
+
+#include <string>
+
+// Prints a JSON report of the vertices of a binary PLY without converting them: min, max, mean and a histogram of the position,
+// log scale, raw opacity, quaternion norm and magnitude of every spherical harmonics band, and counts of NaN and infinite values
+// and of zero quaternions, which can not be converted. The memory mapped file is scanned in parallel.
+bool inspectInput(const std::string& filename);
+
+#endif /*GLTF_INSPECT_H*/
@@ -1,28 +1,55 @@
 #include "io.h"
 
+#include <algorithm>
+#include <filesystem>
 #include <fstream>
 
+#if defined(_WIN32)
+#define NOMINMAX
+#include <fcntl.h>
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 std::string loadFile(const std::string& filename)
+{
+    std::string input{};
+    loadFile(filename, input);
+
+    return input;
+}
+
+bool loadFile(const std::string& filename, std::string& input)
 {
     std::ifstream file(filename, std::ios::ate | std::ios::binary);
     if (!file.is_open())
     {
-        return {};
+        return false;
     }
 
     std::size_t fileSize = static_cast<std::size_t>(file.tellg());
     file.seekg(0);
 
-    std::string input(fileSize, 0);
+    // Keeps the capacity of a previous load.
+    input.resize(fileSize);
 
     file.read(input.data(), fileSize);
     file.close();
 
-    return input;
+    return true;
 }
 
-bool saveFile(const std::string& output, const std::string& filename)
+bool saveFile(std::string_view output, const std::string& filename)
 {
+    // Removing first does not write through hardlinks, e.g. from the conversion cache.
+    std::error_code errorCode{};
+    std::filesystem::remove(filename, errorCode);
+
     std::ofstream file(filename, std::ios::binary);
     if (!file.is_open())
     {
@@ -34,3 +61,147 @@ bool saveFile(const std::string& output, const std::string& filename)
 
     return true;
 }
+
+bool writeStream(std::string_view output, std::FILE* stream)
+{
+    constexpr std::size_t pieceSize{std::size_t{1u} << 22u};
+
+    for (std::size_t offset = 0u; offset < output.size(); offset += pieceSize)
+    {
+        const std::size_t size = std::min(pieceSize, output.size() - offset);
+
+        if (std::fwrite(output.data() + offset, 1u, size, stream) != size)
+        {
+            return false;
+        }
+    }
+
+    return std::fflush(stream) == 0;
+}
+
+#if defined(_WIN32)
+
+std::FILE* redirectStdout()
+{
+    _setmode(_fileno(stdin), _O_BINARY);
+
+    std::fflush(stdout);
+
+    const int output = _dup(_fileno(stdout));
+    if (output < 0 || _dup2(_fileno(stderr), _fileno(stdout)) != 0)
+    {
+        return nullptr;
+    }
+
+    _setmode(output, _O_BINARY);
+
+    return _fdopen(output, "wb");
+}
+
+MappedFile::~MappedFile()
+{
+    if (data)
+    {
+        UnmapViewOfFile(data);
+    }
+    if (handle)
+    {
+        CloseHandle(handle);
+    }
+}
+
+bool mapFile(const std::string& filename, MappedFile& mappedFile)
+{
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize{};
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        CloseHandle(file);
+
+        return false;
+    }
+
+    // The mapping keeps the file open, so the file handle is not needed anymore.
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping)
+    {
+        return false;
+    }
+
+    const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data)
+    {
+        CloseHandle(mapping);
+
+        return false;
+    }
+
+    mappedFile.data = static_cast<const char*>(data);
+    mappedFile.size = static_cast<std::size_t>(fileSize.QuadPart);
+    mappedFile.handle = mapping;
+
+    return true;
+}
+
+#else
+
+std::FILE* redirectStdout()
+{
+    std::fflush(stdout);
+
+    const int output = dup(fileno(stdout));
+    if (output < 0 || dup2(fileno(stderr), fileno(stdout)) < 0)
+    {
+        return nullptr;
+    }
+
+    return fdopen(output, "wb");
+}
+
+MappedFile::~MappedFile()
+{
+    if (data)
+    {
+        munmap(const_cast<char*>(data), size);
+    }
+}
+
+bool mapFile(const std::string& filename, MappedFile& mappedFile)
+{
+    int file = open(filename.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        return false;
+    }
+
+    struct stat fileStat{};
+    if (fstat(file, &fileStat) != 0 || fileStat.st_size == 0)
+    {
+        close(file);
+
+        return false;
+    }
+
+    // The mapping keeps the file referenced, so the descriptor is not needed anymore.
+    void* data = mmap(nullptr, static_cast<std::size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+
+    madvise(data, static_cast<std::size_t>(fileStat.st_size), MADV_SEQUENTIAL);
+
+    mappedFile.data = static_cast<const char*>(data);
+    mappedFile.size = static_cast<std::size_t>(fileStat.st_size);
+
+    return true;
+}
+
+#endif
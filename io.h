@@ -1,10 +1,38 @@
 #ifndef GLTF_IO_H
 #define GLTF_IO_H
 
+#include <cstddef>
+#include <cstdio>
 #include <string>
+#include <string_view>
 
 std::string loadFile(const std::string& filename);
 
-bool saveFile(const std::string& output, const std::string& filename);
+// Loads into the given string, reusing its memory.
+bool loadFile(const std::string& filename, std::string& input);
+
+bool saveFile(std::string_view output, const std::string& filename);
+
+// Read only memory mapping of a whole file, which is unmapped on destruction.
+struct MappedFile
+{
+    const char* data{nullptr};
+    std::size_t size{0u};
+
+    void* handle{nullptr};
+
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+};
+
+bool mapFile(const std::string& filename, MappedFile& mappedFile);
+
+// Switches stdin and stdout to binary mode and redirects printf to stderr. Returns the original stdout for the output data.
+std::FILE* redirectStdout();
+
+// Writes in bounded pieces, so a pipe consumer can start reading early.
+bool writeStream(std::string_view output, std::FILE* stream);
 
 #endif /*GLTF_IO_H*/
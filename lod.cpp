@@ -0,0 +1,472 @@
+#include "lod.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "gltf.h"
+#include "parallel.h"
+
+// Bits per axis of the Morton code.
+constexpr std::uint32_t mortonBits{21u};
+
+// Byte offsets in the interleaved record.
+constexpr std::uint32_t rotationByteOffset{3u * sizeof(float)};
+constexpr std::uint32_t scaleByteOffset{(3u + 4u) * sizeof(float)};
+constexpr std::uint32_t opacityByteOffset{(3u + 4u + 3u) * sizeof(float)};
+constexpr std::uint32_t shByteOffset{(3u + 4u + 3u + 1u) * sizeof(float)};
+
+static std::uint64_t expandBits(std::uint64_t value)
+{
+    value &= 0x1fffffu;
+    value = (value | value << 32u) & 0x1f00000000ffffull;
+    value = (value | value << 16u) & 0x1f0000ff0000ffull;
+    value = (value | value << 8u) & 0x100f00f00f00f00full;
+    value = (value | value << 4u) & 0x10c30c30c30c30c3ull;
+    value = (value | value << 2u) & 0x1249249249249249ull;
+
+    return value;
+}
+
+// Rotation matrix from a normalized quaternion, Indices: 0=x, 1=y, 2=z, 3=w
+static std::array<std::array<double, 3u>, 3u> toMatrix(const float* q)
+{
+    const double x{q[0u]};
+    const double y{q[1u]};
+    const double z{q[2u]};
+    const double w{q[3u]};
+
+    return {{
+        {1.0 - 2.0 * (y * y + z * z), 2.0 * (x * y - z * w), 2.0 * (x * z + y * w)},
+        {2.0 * (x * y + z * w), 1.0 - 2.0 * (x * x + z * z), 2.0 * (y * z - x * w)},
+        {2.0 * (x * z - y * w), 2.0 * (y * z + x * w), 1.0 - 2.0 * (x * x + y * y)}
+    }};
+}
+
+// Normalized quaternion from a rotation matrix, Indices: 0=x, 1=y, 2=z, 3=w
+static void toQuaternion(const std::array<std::array<double, 3u>, 3u>& m, float* q)
+{
+    double x, y, z, w;
+
+    const double trace = m[0][0] + m[1][1] + m[2][2];
+    if (trace > 0.0)
+    {
+        const double s = 0.5 / std::sqrt(trace + 1.0);
+        w = 0.25 / s;
+        x = (m[2][1] - m[1][2]) * s;
+        y = (m[0][2] - m[2][0]) * s;
+        z = (m[1][0] - m[0][1]) * s;
+    }
+    else if (m[0][0] > m[1][1] && m[0][0] > m[2][2])
+    {
+        const double s = 2.0 * std::sqrt(1.0 + m[0][0] - m[1][1] - m[2][2]);
+        w = (m[2][1] - m[1][2]) / s;
+        x = 0.25 * s;
+        y = (m[0][1] + m[1][0]) / s;
+        z = (m[0][2] + m[2][0]) / s;
+    }
+    else if (m[1][1] > m[2][2])
+    {
+        const double s = 2.0 * std::sqrt(1.0 + m[1][1] - m[0][0] - m[2][2]);
+        w = (m[0][2] - m[2][0]) / s;
+        x = (m[0][1] + m[1][0]) / s;
+        y = 0.25 * s;
+        z = (m[1][2] + m[2][1]) / s;
+    }
+    else
+    {
+        const double s = 2.0 * std::sqrt(1.0 + m[2][2] - m[0][0] - m[1][1]);
+        w = (m[1][0] - m[0][1]) / s;
+        x = (m[0][2] + m[2][0]) / s;
+        y = (m[1][2] + m[2][1]) / s;
+        z = 0.25 * s;
+    }
+
+    const double norm = std::sqrt(x * x + y * y + z * z + w * w);
+
+    q[0u] = static_cast<float>(x / norm);
+    q[1u] = static_cast<float>(y / norm);
+    q[2u] = static_cast<float>(z / norm);
+    q[3u] = static_cast<float>(w / norm);
+}
+
+// Cyclic Jacobi eigenvalue algorithm for symmetric 3x3 matrices. Eigenvectors are stored as columns.
+static void decomposeSymmetric(std::array<std::array<double, 3u>, 3u> a, double eigenvalues[3], std::array<std::array<double, 3u>, 3u>& eigenvectors)
+{
+    eigenvectors = {{{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}}};
+
+    for (std::uint32_t sweep = 0u; sweep < 16u; sweep++)
+    {
+        const double offDiagonal = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+        if (offDiagonal < 1e-30)
+        {
+            break;
+        }
+
+        for (std::uint32_t p = 0u; p < 2u; p++)
+        {
+            for (std::uint32_t q = p + 1u; q < 3u; q++)
+            {
+                if (a[p][q] == 0.0)
+                {
+                    continue;
+                }
+
+                const double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+                const double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+                const double c = 1.0 / std::sqrt(t * t + 1.0);
+                const double s = t * c;
+
+                for (std::uint32_t k = 0u; k < 3u; k++)
+                {
+                    const double akp = a[k][p];
+                    const double akq = a[k][q];
+                    a[k][p] = c * akp - s * akq;
+                    a[k][q] = s * akp + c * akq;
+                }
+                for (std::uint32_t k = 0u; k < 3u; k++)
+                {
+                    const double apk = a[p][k];
+                    const double aqk = a[q][k];
+                    a[p][k] = c * apk - s * aqk;
+                    a[q][k] = s * apk + c * aqk;
+                }
+                for (std::uint32_t k = 0u; k < 3u; k++)
+                {
+                    const double vkp = eigenvectors[k][p];
+                    const double vkq = eigenvectors[k][q];
+                    eigenvectors[k][p] = c * vkp - s * vkq;
+                    eigenvectors[k][q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+
+    for (std::uint32_t i = 0u; i < 3u; i++)
+    {
+        eigenvalues[i] = a[i][i];
+    }
+
+    // Eigenvectors have to form a proper rotation.
+    const auto& v = eigenvectors;
+    const double determinant = v[0][0] * (v[1][1] * v[2][2] - v[1][2] * v[2][1]) - v[0][1] * (v[1][0] * v[2][2] - v[1][2] * v[2][0]) + v[0][2] * (v[1][0] * v[2][1] - v[1][1] * v[2][0]);
+    if (determinant < 0.0)
+    {
+        for (std::uint32_t k = 0u; k < 3u; k++)
+        {
+            eigenvectors[k][2u] = -eigenvectors[k][2u];
+        }
+    }
+}
+
+// Moment matching of the clustered splats: Weighted mean and covariance, coverage preserving opacity and weighted spherical harmonics.
+static void mergeCluster(const std::string& binary, const std::pair<std::uint64_t, std::uint32_t>* cluster, std::uint32_t size, std::uint32_t byteStride, char* output)
+{
+    if (size == 1u)
+    {
+        std::memcpy(output, binary.data() + static_cast<std::size_t>(byteStride) * cluster[0u].second, byteStride);
+
+        return;
+    }
+
+    const std::uint32_t shCount = (byteStride - shByteOffset) / sizeof(float);
+
+    // Weight is opacity times volume, so large and opaque splats dominate the result.
+    std::vector<double> weights(size);
+    double weightSum{0.0};
+    for (std::uint32_t i = 0u; i < size; i++)
+    {
+        const char* record = binary.data() + static_cast<std::size_t>(byteStride) * cluster[i].second;
+        const float* scale = reinterpret_cast<const float*>(record + scaleByteOffset);
+        const float* opacity = reinterpret_cast<const float*>(record + opacityByteOffset);
+
+        weights[i] = static_cast<double>(*opacity) * scale[0u] * scale[1u] * scale[2u];
+        weightSum += weights[i];
+    }
+
+    if (!(weightSum > 0.0))
+    {
+        std::fill(weights.begin(), weights.end(), 1.0);
+        weightSum = static_cast<double>(size);
+    }
+
+    double mean[3]{0.0, 0.0, 0.0};
+    for (std::uint32_t i = 0u; i < size; i++)
+    {
+        const float* position = reinterpret_cast<const float*>(binary.data() + static_cast<std::size_t>(byteStride) * cluster[i].second);
+
+        for (std::uint32_t j = 0u; j < 3u; j++)
+        {
+            mean[j] += weights[i] * position[j];
+        }
+    }
+    for (std::uint32_t j = 0u; j < 3u; j++)
+    {
+        mean[j] /= weightSum;
+    }
+
+    std::array<std::array<double, 3u>, 3u> covariance{};
+    std::vector<double> sh(shCount, 0.0);
+    double coverage{0.0};
+
+    for (std::uint32_t i = 0u; i < size; i++)
+    {
+        const char* record = binary.data() + static_cast<std::size_t>(byteStride) * cluster[i].second;
+        const float* position = reinterpret_cast<const float*>(record);
+        const float* rotation = reinterpret_cast<const float*>(record + rotationByteOffset);
+        const float* scale = reinterpret_cast<const float*>(record + scaleByteOffset);
+        const float* opacity = reinterpret_cast<const float*>(record + opacityByteOffset);
+        const float* coefficients = reinterpret_cast<const float*>(record + shByteOffset);
+
+        const auto r = toMatrix(rotation);
+        const double d[3]{position[0u] - mean[0u], position[1u] - mean[1u], position[2u] - mean[2u]};
+
+        for (std::uint32_t j = 0u; j < 3u; j++)
+        {
+            for (std::uint32_t k = 0u; k < 3u; k++)
+            {
+                // R * S^2 * R^T plus the spread of the mean.
+                double value{d[j] * d[k]};
+                for (std::uint32_t m = 0u; m < 3u; m++)
+                {
+                    value += r[j][m] * static_cast<double>(scale[m]) * scale[m] * r[k][m];
+                }
+
+                covariance[j][k] += weights[i] * value;
+            }
+        }
+
+        for (std::uint32_t c = 0u; c < shCount; c++)
+        {
+            sh[c] += weights[i] * coefficients[c];
+        }
+
+        coverage += static_cast<double>(*opacity) * (scale[0u] * scale[1u] + scale[0u] * scale[2u] + scale[1u] * scale[2u]);
+    }
+
+    for (std::uint32_t j = 0u; j < 3u; j++)
+    {
+        for (std::uint32_t k = 0u; k < 3u; k++)
+        {
+            covariance[j][k] /= weightSum;
+        }
+    }
+
+    double eigenvalues[3];
+    std::array<std::array<double, 3u>, 3u> eigenvectors;
+    decomposeSymmetric(covariance, eigenvalues, eigenvectors);
+
+    float* position = reinterpret_cast<float*>(output);
+    float* rotation = reinterpret_cast<float*>(output + rotationByteOffset);
+    float* scale = reinterpret_cast<float*>(output + scaleByteOffset);
+    float* opacity = reinterpret_cast<float*>(output + opacityByteOffset);
+    float* coefficients = reinterpret_cast<float*>(output + shByteOffset);
+
+    for (std::uint32_t j = 0u; j < 3u; j++)
+    {
+        position[j] = static_cast<float>(mean[j]);
+        scale[j] = static_cast<float>(std::sqrt(std::max(eigenvalues[j], 1e-20)));
+    }
+
+    toQuaternion(eigenvectors, rotation);
+
+    // Opacity is chosen, that the merged splat covers the same projected area as the sum of the clustered ones.
+    const double area = static_cast<double>(scale[0u]) * scale[1u] + static_cast<double>(scale[0u]) * scale[2u] + static_cast<double>(scale[1u]) * scale[2u];
+    *opacity = static_cast<float>(std::clamp(area > 0.0 ? coverage / area : 1.0, 0.0, 1.0));
+
+    for (std::uint32_t c = 0u; c < shCount; c++)
+    {
+        coefficients[c] = static_cast<float>(sh[c] / weightSum);
+    }
+}
+
+MergedSplats mergeSplats(const std::string& binary, const std::uint32_t* indices, std::uint32_t size, std::uint32_t degree, std::uint32_t maxCount)
+{
+    const std::uint32_t byteStride = getByteStride(degree);
+
+    MergedSplats merged{};
+    if (size == 0u)
+    {
+        return merged;
+    }
+
+    // Bounds of the given splats.
+    float minPosition[3]{std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+    float maxPosition[3]{std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+    std::mutex boundsMutex{};
+
+    parallelFor(0u, size, [&](std::size_t begin, std::size_t end) {
+        float localMin[3]{std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+        float localMax[3]{std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+
+        for (std::size_t i = begin; i < end; i++)
+        {
+            const float* position = reinterpret_cast<const float*>(binary.data() + static_cast<std::size_t>(byteStride) * indices[i]);
+
+            for (std::uint32_t j = 0u; j < 3u; j++)
+            {
+                localMin[j] = std::min(localMin[j], position[j]);
+                localMax[j] = std::max(localMax[j], position[j]);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(boundsMutex);
+        for (std::uint32_t j = 0u; j < 3u; j++)
+        {
+            minPosition[j] = std::min(minPosition[j], localMin[j]);
+            maxPosition[j] = std::max(maxPosition[j], localMax[j]);
+        }
+    });
+
+    float extent{0.0f};
+    for (std::uint32_t j = 0u; j < 3u; j++)
+    {
+        extent = std::max(extent, maxPosition[j] - minPosition[j]);
+    }
+    if (extent <= 0.0f)
+    {
+        extent = 1.0f;
+    }
+
+    // Sorting by Morton code places every cell of every grid resolution in a contiguous range.
+    const float cellsPerAxis = static_cast<float>((1u << mortonBits) - 1u);
+
+    std::vector<std::pair<std::uint64_t, std::uint32_t>> codes(size);
+    parallelFor(0u, size, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++)
+        {
+            const float* position = reinterpret_cast<const float*>(binary.data() + static_cast<std::size_t>(byteStride) * indices[i]);
+
+            std::uint64_t code{0u};
+            for (std::uint32_t j = 0u; j < 3u; j++)
+            {
+                const auto cell = static_cast<std::uint64_t>((position[j] - minPosition[j]) / extent * cellsPerAxis);
+
+                code |= expandBits(cell) << j;
+            }
+
+            codes[i] = {code, indices[i]};
+        }
+    });
+
+    parallelSort(codes, [](const auto& a, const auto& b) {
+        return a.first < b.first;
+    });
+
+    auto countClusters = [&](std::uint32_t shift) {
+        std::atomic<std::uint32_t> clusters{1u};
+
+        parallelFor(1u, size, [&](std::size_t begin, std::size_t end) {
+            std::uint32_t localClusters{0u};
+            for (std::size_t i = begin; i < end; i++)
+            {
+                if ((codes[i].first >> (3u * shift)) != (codes[i - 1u].first >> (3u * shift)))
+                {
+                    localClusters++;
+                }
+            }
+
+            clusters += localClusters;
+        });
+
+        return clusters.load();
+    };
+
+    // Cluster count is decreasing with coarser grids, so search the finest grid fulfilling the maximum.
+    std::uint32_t lowShift{0u};
+    std::uint32_t highShift{mortonBits};
+    while (lowShift < highShift)
+    {
+        const std::uint32_t shift = (lowShift + highShift) / 2u;
+
+        if (countClusters(shift) <= maxCount)
+        {
+            highShift = shift;
+        }
+        else
+        {
+            lowShift = shift + 1u;
+        }
+    }
+    const std::uint32_t shift{lowShift};
+
+    std::vector<std::uint32_t> starts{};
+    for (std::uint32_t i = 0u; i < size; i++)
+    {
+        if (i == 0u || (codes[i].first >> (3u * shift)) != (codes[i - 1u].first >> (3u * shift)))
+        {
+            starts.push_back(i);
+        }
+    }
+    starts.push_back(size);
+
+    merged.count = static_cast<std::uint32_t>(starts.size() - 1u);
+    merged.cellSize = extent / cellsPerAxis * static_cast<float>(1u << shift);
+    merged.binary.resize(static_cast<std::size_t>(byteStride) * merged.count);
+
+    parallelFor(0u, merged.count, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t cluster = begin; cluster < end; cluster++)
+        {
+            mergeCluster(binary, &codes[starts[cluster]], starts[cluster + 1u] - starts[cluster], byteStride, merged.binary.data() + static_cast<std::size_t>(byteStride) * cluster);
+        }
+    });
+
+    return merged;
+}
+
+void addLevelsOfDetail(nlohmann::json& glTF, std::string& binary, std::uint32_t count, std::uint32_t degree, std::uint32_t levels)
+{
+    std::vector<std::uint32_t> indices(count);
+    for (std::uint32_t i = 0u; i < count; i++)
+    {
+        indices[i] = i;
+    }
+
+    nlohmann::json ids = nlohmann::json::array();
+
+    std::uint32_t previousCount{count};
+    for (std::uint32_t level = 1u; level <= levels; level++)
+    {
+        // Always merging the original splats avoids accumulating the error of previous levels.
+        MergedSplats merged = mergeSplats(binary, indices.data(), count, degree, std::max(previousCount / 4u, 1u));
+        if (merged.count >= previousCount)
+        {
+            break;
+        }
+
+        printf("Info: Level of detail %u with %u splats\n", level, merged.count);
+
+        const std::size_t byteOffset = binary.size();
+        binary += merged.binary;
+
+        const std::uint32_t meshIndex = addMesh(glTF, byteOffset, merged.binary, merged.count, degree);
+
+        nlohmann::json node = nlohmann::json::object();
+        node["mesh"] = meshIndex;
+
+        ids.push_back(glTF["nodes"].size());
+        glTF["nodes"].push_back(node);
+
+        previousCount = merged.count;
+    }
+
+    glTF["buffers"][0u]["byteLength"] = binary.size();
+
+    if (ids.empty())
+    {
+        return;
+    }
+
+    glTF["extensionsUsed"].push_back("MSFT_lod");
+
+    glTF["nodes"][0u]["extensions"] = nlohmann::json::object();
+    glTF["nodes"][0u]["extensions"]["MSFT_lod"] = nlohmann::json::object();
+    glTF["nodes"][0u]["extensions"]["MSFT_lod"]["ids"] = ids;
+}
@@ -0,0 +1,25 @@
+#ifndef GLTF_LOD_H
+#define GLTF_LOD_H
+
+#include <cstdint>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+struct MergedSplats
+{
+    std::string binary{};
+    std::uint32_t count{0u};
+
+    // Edge length of the grid cells the splats were clustered in, usable as geometric error.
+    float cellSize{0.0f};
+};
+
+// Clusters the indexed splats on the finest grid resulting in at most maxCount clusters and merges every cluster into one splat.
+MergedSplats mergeSplats(const std::string& binary, const std::uint32_t* indices, std::uint32_t size, std::uint32_t degree, std::uint32_t maxCount);
+
+// Appends up to the given amount of coarser levels to binary, each with about a quarter of the splats of the previous level.
+// Every level gets its own mesh and node, referenced by the first node using MSFT_lod.
+void addLevelsOfDetail(nlohmann::json& glTF, std::string& binary, std::uint32_t count, std::uint32_t degree, std::uint32_t levels);
+
+#endif /*GLTF_LOD_H*/
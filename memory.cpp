@@ -0,0 +1,434 @@
+#include "memory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+#include "parallel.h"
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+// Updated by every allocation, so only relaxed atomics.
+static std::atomic<std::uint64_t> allocationCount{0u};
+static std::atomic<std::uint64_t> allocationBytes{0u};
+static thread_local std::uint64_t threadAllocationCount{0u};
+
+//
+// Arena
+//
+
+// Address space, which costs no memory until touched.
+constexpr std::size_t arenaReservation{std::size_t{1u} << 38u};
+
+// Smallest block is the size of a huge page. Every size class doubles the block size.
+constexpr std::size_t arenaMinimumBlock{std::size_t{1u} << 21u};
+constexpr std::uint32_t arenaSizeClasses{17u};
+
+// Header in front of the returned memory, keeping the alignment of operator new.
+constexpr std::size_t arenaHeaderSize{64u};
+
+constexpr std::size_t pageSize{4096u};
+
+struct ArenaBlock
+{
+    std::uint32_t sizeClass{0u};
+    // False for fresh blocks and for pooled blocks, which pages have been released.
+    bool resident{false};
+    ArenaBlock* next{nullptr};
+};
+
+static std::atomic<std::uintptr_t> arenaBegin{0u};
+static std::atomic<std::uintptr_t> arenaEnd{0u};
+
+static std::mutex arenaMutex{};
+static char* arenaNext{nullptr};
+static ArenaBlock* arenaFreeBlocks[arenaSizeClasses]{};
+static std::size_t arenaPooledBytes{0u};
+static ArenaPolicy arenaPolicy{};
+
+static bool commitPages([[maybe_unused]] char* data, [[maybe_unused]] std::size_t size)
+{
+#if defined(_WIN32)
+    return VirtualAlloc(data, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#else
+    // Reservation is already readable and writable.
+    return true;
+#endif
+}
+
+static void releasePages(char* data, std::size_t size)
+{
+#if defined(_WIN32)
+    VirtualFree(data, size, MEM_DECOMMIT);
+#else
+    madvise(data, size, MADV_DONTNEED);
+#endif
+}
+
+static void prefaultPages(char* data, std::size_t size)
+{
+    // Page faults are resolved concurrently by the kernel, so touching in parallel is faster.
+    parallelFor(0u, (size + pageSize - 1u) / pageSize, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t page = begin; page < end; page++)
+        {
+            static_cast<volatile char*>(data)[page * pageSize] = 0;
+        }
+    });
+}
+
+static void* arenaAllocate(std::size_t size)
+{
+    std::uint32_t sizeClass{0u};
+    while (sizeClass < arenaSizeClasses && (arenaMinimumBlock << sizeClass) < size + arenaHeaderSize)
+    {
+        sizeClass++;
+    }
+    if (sizeClass == arenaSizeClasses)
+    {
+        return nullptr;
+    }
+
+    const std::size_t blockSize{arenaMinimumBlock << sizeClass};
+
+    ArenaBlock* block{nullptr};
+    bool prefault{false};
+    {
+        std::lock_guard<std::mutex> lock(arenaMutex);
+
+        block = arenaFreeBlocks[sizeClass];
+        if (block)
+        {
+            arenaFreeBlocks[sizeClass] = block->next;
+
+            if (block->resident)
+            {
+                arenaPooledBytes -= blockSize;
+            }
+            else if (!commitPages(reinterpret_cast<char*>(block), blockSize))
+            {
+                block->next = arenaFreeBlocks[sizeClass];
+                arenaFreeBlocks[sizeClass] = block;
+
+                return nullptr;
+            }
+        }
+        else
+        {
+            if (reinterpret_cast<std::uintptr_t>(arenaNext) + blockSize > arenaEnd.load(std::memory_order_relaxed) || !commitPages(arenaNext, blockSize))
+            {
+                return nullptr;
+            }
+
+            block = new (arenaNext) ArenaBlock{};
+            block->sizeClass = sizeClass;
+
+            arenaNext += blockSize;
+        }
+
+        prefault = arenaPolicy.prefault && !block->resident;
+
+        block->resident = true;
+        block->next = nullptr;
+    }
+
+    if (prefault)
+    {
+        prefaultPages(reinterpret_cast<char*>(block), size + arenaHeaderSize);
+    }
+
+    return reinterpret_cast<char*>(block) + arenaHeaderSize;
+}
+
+static void arenaDeallocate(void* pointer)
+{
+    ArenaBlock* block = reinterpret_cast<ArenaBlock*>(static_cast<char*>(pointer) - arenaHeaderSize);
+
+    const std::size_t blockSize{arenaMinimumBlock << block->sizeClass};
+
+    std::lock_guard<std::mutex> lock(arenaMutex);
+
+    if (arenaPooledBytes + blockSize > arenaPolicy.poolSize)
+    {
+        // First page keeps the header.
+        releasePages(reinterpret_cast<char*>(block) + pageSize, blockSize - pageSize);
+
+        block->resident = false;
+    }
+    else
+    {
+        arenaPooledBytes += blockSize;
+    }
+
+    block->next = arenaFreeBlocks[block->sizeClass];
+    arenaFreeBlocks[block->sizeClass] = block;
+}
+
+bool enableArena(const ArenaPolicy& policy)
+{
+    std::lock_guard<std::mutex> lock(arenaMutex);
+
+    arenaPolicy = policy;
+
+    if (arenaBegin.load(std::memory_order_relaxed))
+    {
+        return true;
+    }
+
+#if defined(_WIN32)
+    // Large pages require a privilege on Windows, so the policy is not applied.
+    void* data = VirtualAlloc(nullptr, arenaReservation, MEM_RESERVE, PAGE_READWRITE);
+    if (!data)
+    {
+        return false;
+    }
+
+    char* begin = static_cast<char*>(data);
+#else
+    // Additional block to align the beginning, so huge pages can back whole blocks.
+    void* data = mmap(nullptr, arenaReservation + arenaMinimumBlock, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+
+    char* begin = reinterpret_cast<char*>((reinterpret_cast<std::uintptr_t>(data) + arenaMinimumBlock - 1u) & ~(arenaMinimumBlock - 1u));
+
+#if defined(MADV_HUGEPAGE)
+    if (policy.hugePages)
+    {
+        madvise(begin, arenaReservation, MADV_HUGEPAGE);
+    }
+#endif
+#endif
+
+    arenaNext = begin;
+    arenaEnd.store(reinterpret_cast<std::uintptr_t>(begin) + arenaReservation, std::memory_order_relaxed);
+    arenaBegin.store(reinterpret_cast<std::uintptr_t>(begin), std::memory_order_release);
+
+    return true;
+}
+
+//
+// Global allocation functions
+//
+
+static void countAllocation(std::size_t size)
+{
+    allocationCount.fetch_add(1u, std::memory_order_relaxed);
+    allocationBytes.fetch_add(size, std::memory_order_relaxed);
+    threadAllocationCount++;
+}
+
+// Returns nullptr, if the arena is not enabled, full or the size too small.
+static void* allocateLarge(std::size_t size)
+{
+    // From half of the smallest block on, rounding up to blocks wastes at most half of the address space.
+    if (size >= arenaMinimumBlock / 2u && arenaBegin.load(std::memory_order_acquire))
+    {
+        return arenaAllocate(size);
+    }
+
+    return nullptr;
+}
+
+static bool isInArena(void* pointer)
+{
+    const std::uintptr_t address{reinterpret_cast<std::uintptr_t>(pointer)};
+
+    const std::uintptr_t begin = arenaBegin.load(std::memory_order_acquire);
+
+    return begin && address >= begin && address < arenaEnd.load(std::memory_order_relaxed);
+}
+
+static void* allocate(std::size_t size)
+{
+    countAllocation(size);
+
+    void* pointer = allocateLarge(size);
+    if (pointer)
+    {
+        return pointer;
+    }
+
+    return std::malloc(size > 0u ? size : 1u);
+}
+
+static void deallocate(void* pointer)
+{
+    if (isInArena(pointer))
+    {
+        arenaDeallocate(pointer);
+
+        return;
+    }
+
+    std::free(pointer);
+}
+
+// Over-aligned types e.g. the queue cells of the pipeline. Arena blocks start at pages, so their memory is aligned like the header.
+static void* allocateAligned(std::size_t size, std::size_t alignment)
+{
+    countAllocation(size);
+
+    void* pointer = alignment <= arenaHeaderSize ? allocateLarge(size) : nullptr;
+    if (pointer)
+    {
+        return pointer;
+    }
+
+#if defined(_WIN32)
+    return _aligned_malloc(size > 0u ? size : 1u, alignment);
+#else
+    // Size has to be a multiple of the alignment.
+    return std::aligned_alloc(alignment, (std::max<std::size_t>(size, 1u) + alignment - 1u) / alignment * alignment);
+#endif
+}
+
+static void deallocateAligned(void* pointer)
+{
+    if (isInArena(pointer))
+    {
+        arenaDeallocate(pointer);
+
+        return;
+    }
+
+#if defined(_WIN32)
+    _aligned_free(pointer);
+#else
+    std::free(pointer);
+#endif
+}
+
+AllocationStats getAllocationStats()
+{
+    AllocationStats stats{};
+    stats.count = allocationCount.load(std::memory_order_relaxed);
+    stats.bytes = allocationBytes.load(std::memory_order_relaxed);
+
+    return stats;
+}
+
+std::uint64_t getThreadAllocationCount()
+{
+    return threadAllocationCount;
+}
+
+void* operator new(std::size_t size)
+{
+    void* pointer = allocate(size);
+    if (!pointer)
+    {
+        throw std::bad_alloc{};
+    }
+
+    return pointer;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    deallocate(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    deallocate(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    deallocate(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+    deallocate(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+    deallocate(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+    deallocate(pointer);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    void* pointer = allocateAligned(size, static_cast<std::size_t>(alignment));
+    if (!pointer)
+    {
+        throw std::bad_alloc{};
+    }
+
+    return pointer;
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return allocateAligned(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return allocateAligned(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+    deallocateAligned(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept
+{
+    deallocateAligned(pointer);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept
+{
+    deallocateAligned(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept
+{
+    deallocateAligned(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    deallocateAligned(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    deallocateAligned(pointer);
+}
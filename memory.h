@@ -0,0 +1,33 @@
+#ifndef GLTF_MEMORY_H
+#define GLTF_MEMORY_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Counters of the global operator new over all threads.
+struct AllocationStats
+{
+    std::uint64_t count{0u};
+    std::uint64_t bytes{0u};
+};
+
+AllocationStats getAllocationStats();
+
+// Allocations of the calling thread only, e.g. to check a hot path for zero heap allocations.
+std::uint64_t getThreadAllocationCount();
+
+struct ArenaPolicy
+{
+    // Transparent huge pages are requested for the arena, reducing page faults and TLB misses.
+    bool hugePages{false};
+    // Pages of new blocks are faulted in by all cores at allocation.
+    bool prefault{false};
+    // Freed blocks stay resident up to this amount of bytes for reuse, beyond their pages are released.
+    std::size_t poolSize{std::size_t{1u} << 32u};
+};
+
+// Serves large allocations, as of the conversion buffers, from pooled blocks of a reserved address range instead of malloc.
+// Small allocations e.g. of JSON trees are only counted. Returns false, if the address range could not be reserved.
+bool enableArena(const ArenaPolicy& policy);
+
+#endif /*GLTF_MEMORY_H*/
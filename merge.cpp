@@ -0,0 +1,492 @@
+#include "merge.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <thread>
+
+#include <nlohmann/json.hpp>
+
+#include "gltf.h"
+#include "input.h"
+#include "parallel.h"
+#include "ply.h"
+
+using json = nlohmann::json;
+
+// Highest supported spherical harmonics degree.
+constexpr std::uint32_t maxDegree{3u};
+
+// Byte offsets in the interleaved record.
+constexpr std::uint32_t rotationByteOffset{3u * sizeof(float)};
+constexpr std::uint32_t scaleByteOffset{(3u + 4u) * sizeof(float)};
+constexpr std::uint32_t higherByteOffset{(3u + 4u + 3u + 1u + 3u) * sizeof(float)};
+
+// Directions sampling the sphere, which determine the spherical harmonics rotation by least squares.
+constexpr std::uint32_t sampleCount{64u};
+
+struct LoadedInput
+{
+    PlyHeader header{};
+    std::string binary{};
+    bool success{false};
+};
+
+// Rotation, uniform scale and translation baked into the splats.
+struct Transform
+{
+    float translation[3]{};
+    float rotation[4]{};
+    float scale{1.0f};
+
+    float matrix[3][3]{};
+
+    // Rotation of each band, starting with the negative index as in the record.
+    double shRotation[maxDegree][7u][7u]{};
+};
+
+//
+// Spherical harmonics rotation
+//
+
+// Real spherical harmonics of degree l > 0 at the direction, using the basis and signs of the original 3DGS implementation.
+static void evaluateBand(std::uint32_t l, const double d[3], double* result)
+{
+    const double x{d[0u]};
+    const double y{d[1u]};
+    const double z{d[2u]};
+
+    if (l == 1u)
+    {
+        const double c1{0.4886025119029199};
+
+        result[0u] = -c1 * y;
+        result[1u] = c1 * z;
+        result[2u] = -c1 * x;
+    }
+    else if (l == 2u)
+    {
+        result[0u] = 1.0925484305920792 * x * y;
+        result[1u] = -1.0925484305920792 * y * z;
+        result[2u] = 0.31539156525252005 * (2.0 * z * z - x * x - y * y);
+        result[3u] = -1.0925484305920792 * x * z;
+        result[4u] = 0.5462742152960396 * (x * x - y * y);
+    }
+    else
+    {
+        result[0u] = -0.5900435899266435 * y * (3.0 * x * x - y * y);
+        result[1u] = 2.890611442640554 * x * y * z;
+        result[2u] = -0.4570457994644658 * y * (4.0 * z * z - x * x - y * y);
+        result[3u] = 0.3731763325901154 * z * (2.0 * z * z - 3.0 * x * x - 3.0 * y * y);
+        result[4u] = -0.4570457994644658 * x * (4.0 * z * z - x * x - y * y);
+        result[5u] = 1.445305721320277 * z * (x * x - y * y);
+        result[6u] = -0.5900435899266435 * x * (x * x - 3.0 * y * y);
+    }
+}
+
+// Solves the symmetric positive definite system in place by Gaussian elimination, with size right hand sides.
+static void solve(double a[7u][7u], double b[7u][7u], std::uint32_t size)
+{
+    for (std::uint32_t pivot = 0u; pivot < size; pivot++)
+    {
+        for (std::uint32_t row = pivot + 1u; row < size; row++)
+        {
+            const double factor = a[row][pivot] / a[pivot][pivot];
+            for (std::uint32_t column = 0u; column < size; column++)
+            {
+                a[row][column] -= factor * a[pivot][column];
+                b[row][column] -= factor * b[pivot][column];
+            }
+        }
+    }
+
+    for (std::uint32_t pivot = size; pivot-- > 0u;)
+    {
+        for (std::uint32_t column = 0u; column < size; column++)
+        {
+            for (std::uint32_t k = pivot + 1u; k < size; k++)
+            {
+                b[pivot][column] -= a[pivot][k] * b[k][column];
+            }
+            b[pivot][column] /= a[pivot][pivot];
+        }
+    }
+}
+
+// The rotated radiance at direction d equals the original one at the inversely rotated direction. Sampling both on the
+// sphere and fitting by least squares gives the rotation matrix of each band, which is exact as the bands are closed under rotation.
+static void computeShRotation(const float matrix[3][3], double shRotation[maxDegree][7u][7u])
+{
+    for (std::uint32_t l = 1u; l <= maxDegree; l++)
+    {
+        const std::uint32_t size{1u + 2u * l};
+
+        double normal[7u][7u]{};
+        double right[7u][7u]{};
+
+        for (std::uint32_t sample = 0u; sample < sampleCount; sample++)
+        {
+            // Fibonacci sphere.
+            const double z = 1.0 - (2.0 * sample + 1.0) / sampleCount;
+            const double radius = std::sqrt(1.0 - z * z);
+            const double phi = sample * 2.399963229728653;
+
+            const double d[3u]{radius * std::cos(phi), radius * std::sin(phi), z};
+
+            // Transposed rotation is the inverse.
+            double rotated[3u]{};
+            for (std::uint32_t i = 0u; i < 3u; i++)
+            {
+                for (std::uint32_t j = 0u; j < 3u; j++)
+                {
+                    rotated[i] += matrix[j][i] * d[j];
+                }
+            }
+
+            double basis[7u];
+            double rotatedBasis[7u];
+            evaluateBand(l, d, basis);
+            evaluateBand(l, rotated, rotatedBasis);
+
+            for (std::uint32_t i = 0u; i < size; i++)
+            {
+                for (std::uint32_t j = 0u; j < size; j++)
+                {
+                    normal[i][j] += basis[i] * basis[j];
+                    right[i][j] += basis[i] * rotatedBasis[j];
+                }
+            }
+        }
+
+        solve(normal, right, size);
+
+        for (std::uint32_t i = 0u; i < size; i++)
+        {
+            for (std::uint32_t j = 0u; j < size; j++)
+            {
+                shRotation[l - 1u][i][j] = right[i][j];
+            }
+        }
+    }
+}
+
+static Transform createTransform(const MergeInput& input)
+{
+    Transform transform{};
+
+    std::copy_n(input.translation, 3u, transform.translation);
+    transform.scale = input.scale;
+
+    float x{input.rotation[0u]};
+    float y{input.rotation[1u]};
+    float z{input.rotation[2u]};
+    float w{input.rotation[3u]};
+
+    const float norm = std::sqrt(x * x + y * y + z * z + w * w);
+    x /= norm;
+    y /= norm;
+    z /= norm;
+    w /= norm;
+
+    transform.rotation[0u] = x;
+    transform.rotation[1u] = y;
+    transform.rotation[2u] = z;
+    transform.rotation[3u] = w;
+
+    transform.matrix[0u][0u] = 1.0f - 2.0f * (y * y + z * z);
+    transform.matrix[0u][1u] = 2.0f * (x * y - z * w);
+    transform.matrix[0u][2u] = 2.0f * (x * z + y * w);
+    transform.matrix[1u][0u] = 2.0f * (x * y + z * w);
+    transform.matrix[1u][1u] = 1.0f - 2.0f * (x * x + z * z);
+    transform.matrix[1u][2u] = 2.0f * (y * z - x * w);
+    transform.matrix[2u][0u] = 2.0f * (x * z - y * w);
+    transform.matrix[2u][1u] = 2.0f * (y * z + x * w);
+    transform.matrix[2u][2u] = 1.0f - 2.0f * (x * x + y * y);
+
+    computeShRotation(transform.matrix, transform.shRotation);
+
+    return transform;
+}
+
+static bool isIdentity(const MergeInput& input)
+{
+    return input.translation[0u] == 0.0f && input.translation[1u] == 0.0f && input.translation[2u] == 0.0f &&
+           input.rotation[0u] == 0.0f && input.rotation[1u] == 0.0f && input.rotation[2u] == 0.0f && input.scale == 1.0f;
+}
+
+//
+// Record conversion
+//
+
+// Copies count records into the given degree, padding or truncating the spherical harmonics, and applies the optional transform.
+static void copyRecords(const std::string& source, std::uint32_t sourceDegree, std::size_t count, const Transform* transform, std::uint32_t degree, char* destination)
+{
+    const std::uint32_t sourceByteStride = getByteStride(sourceDegree);
+    const std::uint32_t byteStride = getByteStride(degree);
+    const std::uint32_t commonByteStride = getByteStride(std::min(sourceDegree, degree));
+
+    parallelFor(0u, count, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t vertex = begin; vertex < end; vertex++)
+        {
+            char* record = destination + byteStride * vertex;
+
+            std::memcpy(record, source.data() + sourceByteStride * vertex, commonByteStride);
+            std::memset(record + commonByteStride, 0, byteStride - commonByteStride);
+
+            if (!transform)
+            {
+                continue;
+            }
+
+            // Records are aligned to float in the destination.
+            float* position = reinterpret_cast<float*>(record);
+            float* rotation = reinterpret_cast<float*>(record + rotationByteOffset);
+            float* scale = reinterpret_cast<float*>(record + scaleByteOffset);
+            float* higher = reinterpret_cast<float*>(record + higherByteOffset);
+
+            const float p[3u]{position[0u] * transform->scale, position[1u] * transform->scale, position[2u] * transform->scale};
+            for (std::uint32_t i = 0u; i < 3u; i++)
+            {
+                position[i] = transform->matrix[i][0u] * p[0u] + transform->matrix[i][1u] * p[1u] + transform->matrix[i][2u] * p[2u] + transform->translation[i];
+            }
+
+            // Rotation of the transform applied after the splat rotation. Indices: 0=x, 1=y, 2=z, 3=w
+            const float* q1 = transform->rotation;
+            const float q0[4u]{rotation[0u], rotation[1u], rotation[2u], rotation[3u]};
+            rotation[0u] = q1[3] * q0[0] + q1[0] * q0[3] + q1[1] * q0[2] - q1[2] * q0[1];
+            rotation[1u] = q1[3] * q0[1] - q1[0] * q0[2] + q1[1] * q0[3] + q1[2] * q0[0];
+            rotation[2u] = q1[3] * q0[2] + q1[0] * q0[1] - q1[1] * q0[0] + q1[2] * q0[3];
+            rotation[3u] = q1[3] * q0[3] - q1[0] * q0[0] - q1[1] * q0[1] - q1[2] * q0[2];
+
+            for (std::uint32_t i = 0u; i < 3u; i++)
+            {
+                scale[i] *= transform->scale;
+            }
+
+            // Coefficients are stored as RGB per coefficient, ordered by band.
+            for (std::uint32_t l = 1u; l <= degree; l++)
+            {
+                const std::uint32_t size{1u + 2u * l};
+
+                double rotated[7u][3u]{};
+                for (std::uint32_t i = 0u; i < size; i++)
+                {
+                    for (std::uint32_t j = 0u; j < size; j++)
+                    {
+                        for (std::uint32_t c = 0u; c < 3u; c++)
+                        {
+                            rotated[i][c] += transform->shRotation[l - 1u][i][j] * higher[3u * j + c];
+                        }
+                    }
+                }
+
+                for (std::uint32_t i = 0u; i < size; i++)
+                {
+                    for (std::uint32_t c = 0u; c < 3u; c++)
+                    {
+                        higher[3u * i + c] = static_cast<float>(rotated[i][c]);
+                    }
+                }
+
+                higher += 3u * size;
+            }
+        }
+    });
+}
+
+bool mergeInputs(const MergeOptions& options)
+{
+    if (options.inputs.empty())
+    {
+        printf("Error: No inputs to merge\n");
+
+        return false;
+    }
+
+    for (const auto& input : options.inputs)
+    {
+        const InputFormat inputFormat = getInputFormat(input.filename);
+        if (!isInputFormatSupported(inputFormat) || inputFormat == InputFormat::GLTF || inputFormat == InputFormat::GLB || input.filename == "-")
+        {
+            printf("Error: Format of '%s' can not be merged\n", input.filename.c_str());
+
+            return false;
+        }
+
+        if (!(input.scale > 0.0f) || (input.rotation[0u] == 0.0f && input.rotation[1u] == 0.0f && input.rotation[2u] == 0.0f && input.rotation[3u] == 0.0f))
+        {
+            printf("Error: Invalid transform of '%s'\n", input.filename.c_str());
+
+            return false;
+        }
+    }
+
+    if (options.convert)
+    {
+        printf("Info: Converting from z-up right-handed to y-up right-handed coordinate system.\n");
+    }
+
+    //
+    // Loading all inputs concurrently.
+    //
+
+    std::vector<LoadedInput> loaded(options.inputs.size());
+
+    std::vector<std::thread> threads{};
+    for (std::size_t i = 0u; i < options.inputs.size(); i++)
+    {
+        threads.emplace_back([&, i]() {
+            // The loaded PLY is only needed while converting.
+            std::string input{};
+            std::uint64_t convertAllocations{0u};
+
+            loaded[i].success = loadInput(options.inputs[i].filename, getInputFormat(options.inputs[i].filename), options.convert, input, loaded[i].header, loaded[i].binary, convertAllocations);
+        });
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    std::uint64_t totalCount{0u};
+    std::uint32_t highestDegree{0u};
+    for (const auto& input : loaded)
+    {
+        if (!input.success)
+        {
+            return false;
+        }
+
+        totalCount += input.header.count;
+        highestDegree = std::max(highestDegree, input.header.degree);
+    }
+
+    if (totalCount > std::numeric_limits<std::uint32_t>::max())
+    {
+        printf("Error: Merged inputs exceed %u splats\n", std::numeric_limits<std::uint32_t>::max());
+
+        return false;
+    }
+
+    const std::uint32_t degree = options.degree < 0 ? highestDegree : std::min(static_cast<std::uint32_t>(options.degree), maxDegree);
+
+    //
+    // Combining into one buffer.
+    //
+
+    const std::filesystem::path outputPath(options.output);
+    const std::string stem = outputPath.stem().generic_string();
+    const std::string outputDirectory = outputPath.parent_path().generic_string();
+
+    const std::string savenameJson{(outputPath.parent_path() / (stem + ".gltf")).generic_string()};
+    const std::string savenameBinary{stem + ".bin"};
+
+    std::string binary{};
+    json glTF{};
+
+    if (!options.separate)
+    {
+        printf("Info: Merging %zu inputs into one primitive of %llu splats with degree %u\n", loaded.size(), static_cast<unsigned long long>(totalCount), degree);
+
+        const std::size_t byteStride{getByteStride(degree)};
+        binary.resize(byteStride * totalCount);
+
+        std::size_t offset{0u};
+        for (std::size_t i = 0u; i < loaded.size(); i++)
+        {
+            const Transform transform = createTransform(options.inputs[i]);
+
+            copyRecords(loaded[i].binary, loaded[i].header.degree, loaded[i].header.count, isIdentity(options.inputs[i]) ? nullptr : &transform, degree, binary.data() + byteStride * offset);
+
+            offset += loaded[i].header.count;
+
+            // Released early, as the merged buffer holds a copy.
+            std::string().swap(loaded[i].binary);
+        }
+
+        glTF = createGltf(savenameBinary, binary, static_cast<std::uint32_t>(totalCount), degree);
+    }
+    else
+    {
+        printf("Info: Merging %zu inputs into one node and mesh each\n", loaded.size());
+
+        // Inputs keep their degree, unless one is requested.
+        std::vector<std::uint32_t> degrees(loaded.size());
+        std::vector<std::size_t> byteOffsets(loaded.size());
+
+        std::size_t byteLength{0u};
+        for (std::size_t i = 0u; i < loaded.size(); i++)
+        {
+            degrees[i] = options.degree < 0 ? loaded[i].header.degree : degree;
+            byteOffsets[i] = byteLength;
+
+            byteLength += static_cast<std::size_t>(getByteStride(degrees[i])) * loaded[i].header.count;
+        }
+
+        binary.resize(byteLength);
+
+        for (std::size_t i = 0u; i < loaded.size(); i++)
+        {
+            std::string records(static_cast<std::size_t>(getByteStride(degrees[i])) * loaded[i].header.count, '\0');
+
+            copyRecords(loaded[i].binary, loaded[i].header.degree, loaded[i].header.count, nullptr, degrees[i], records.data());
+            std::string().swap(loaded[i].binary);
+
+            if (i == 0u)
+            {
+                glTF = createGltf(savenameBinary, records, loaded[i].header.count, degrees[i]);
+            }
+            else
+            {
+                json node = json::object();
+                node["mesh"] = addMesh(glTF, byteOffsets[i], records, loaded[i].header.count, degrees[i]);
+
+                glTF["scenes"][0u]["nodes"].push_back(glTF["nodes"].size());
+                glTF["nodes"].push_back(node);
+            }
+
+            std::memcpy(binary.data() + byteOffsets[i], records.data(), records.size());
+
+            // Transform is kept on the node, so it stays exact and editable.
+            const MergeInput& input = options.inputs[i];
+            json& node = glTF["nodes"][i];
+
+            node["name"] = std::filesystem::path(input.filename).filename().generic_string();
+
+            if (input.translation[0u] != 0.0f || input.translation[1u] != 0.0f || input.translation[2u] != 0.0f)
+            {
+                node["translation"] = {input.translation[0u], input.translation[1u], input.translation[2u]};
+            }
+            if (input.rotation[0u] != 0.0f || input.rotation[1u] != 0.0f || input.rotation[2u] != 0.0f)
+            {
+                const Transform transform = createTransform(input);
+
+                node["rotation"] = {transform.rotation[0u], transform.rotation[1u], transform.rotation[2u], transform.rotation[3u]};
+            }
+            if (input.scale != 1.0f)
+            {
+                node["scale"] = {input.scale, input.scale, input.scale};
+            }
+        }
+
+        glTF["buffers"][0u]["byteLength"] = binary.size();
+    }
+
+    //
+    // Storing to disk.
+    //
+
+    std::vector<std::string> outputs{};
+    if (!saveGltf(glTF, binary, options.maxBufferSize, outputDirectory, savenameBinary, savenameJson, outputs))
+    {
+        return false;
+    }
+
+    printf("Info: Success\n");
+
+    return true;
+}
@@ -0,0 +1,36 @@
+#ifndef GLTF_MERGE_H
+#define GLTF_MERGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct MergeInput
+{
+    std::string filename{};
+
+    // Applied after the optional coordinate system conversion: uniform scale, then rotation and translation.
+    float translation[3]{0.0f, 0.0f, 0.0f};
+    float rotation[4]{0.0f, 0.0f, 0.0f, 1.0f};
+    float scale{1.0f};
+};
+
+struct MergeOptions
+{
+    std::vector<MergeInput> inputs{};
+    // glTF to save, the buffers are named after its stem.
+    std::string output{};
+    bool convert{false};
+    // Emits one node and mesh per input instead of a single primitive.
+    bool separate{false};
+    // Spherical harmonics degree of the output, or the highest degree of the inputs if negative.
+    std::int32_t degree{-1};
+    std::size_t maxBufferSize{std::size_t{1u} << 31u};
+};
+
+// Loads all inputs concurrently and saves them as one glTF sharing a single buffer. Inputs with a lower spherical harmonics
+// degree are padded with zeros and ones with a higher degree are truncated.
+bool mergeInputs(const MergeOptions& options);
+
+#endif /*GLTF_MERGE_H*/
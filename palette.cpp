@@ -0,0 +1,360 @@
+#include "palette.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <random>
+
+#include "gltf.h"
+#include "parallel.h"
+
+using json = nlohmann::json;
+
+// Lloyd iterations of every k-means run.
+constexpr std::uint32_t iterations{8u};
+
+// Training samples per codebook entry, as clustering all splats would be too slow.
+constexpr std::uint32_t samplesPerEntry{64u};
+
+// Byte offset of the higher degree coefficients in the interleaved record.
+constexpr std::uint32_t restByteOffset{(3u + 4u + 3u + 1u + 3u) * sizeof(float)};
+
+// Squared euclidean distance. Independent partial sums allow the compiler to vectorize without reordering floating point additions.
+static float getDistance(const float* a, const float* b, std::uint32_t dimensions)
+{
+    float sums[8u]{};
+
+    std::uint32_t i{0u};
+    for (; i + 8u <= dimensions; i += 8u)
+    {
+        for (std::uint32_t lane = 0u; lane < 8u; lane++)
+        {
+            const float difference = a[i + lane] - b[i + lane];
+
+            sums[lane] += difference * difference;
+        }
+    }
+    for (; i < dimensions; i++)
+    {
+        const float difference = a[i] - b[i];
+
+        sums[0u] += difference * difference;
+    }
+
+    return ((sums[0u] + sums[1u]) + (sums[2u] + sums[3u])) + ((sums[4u] + sums[5u]) + (sums[6u] + sums[7u]));
+}
+
+static std::uint32_t getNearest(const float* vector, const float* centroids, std::uint32_t centroidCount, std::uint32_t dimensions)
+{
+    std::uint32_t nearest{0u};
+    float nearestDistance{std::numeric_limits<float>::max()};
+
+    for (std::uint32_t c = 0u; c < centroidCount; c++)
+    {
+        const float distance = getDistance(vector, centroids + static_cast<std::size_t>(c) * dimensions, dimensions);
+        if (distance < nearestDistance)
+        {
+            nearestDistance = distance;
+            nearest = c;
+        }
+    }
+
+    return nearest;
+}
+
+// Lloyd's algorithm over the given vectors. Initial centroids are evenly spread over the vectors, which are expected to be shuffled.
+static std::vector<float> kMeans(const std::vector<const float*>& vectors, std::uint32_t centroidCount, std::uint32_t dimensions)
+{
+    centroidCount = std::min<std::uint32_t>(centroidCount, static_cast<std::uint32_t>(vectors.size()));
+
+    std::vector<float> centroids(static_cast<std::size_t>(centroidCount) * dimensions);
+    for (std::uint32_t c = 0u; c < centroidCount; c++)
+    {
+        std::memcpy(centroids.data() + static_cast<std::size_t>(c) * dimensions, vectors[vectors.size() * c / centroidCount], dimensions * sizeof(float));
+    }
+
+    std::vector<std::uint32_t> assignments(vectors.size());
+
+    for (std::uint32_t iteration = 0u; iteration < iterations; iteration++)
+    {
+        parallelFor(0u, vectors.size(), [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; i++)
+            {
+                assignments[i] = getNearest(vectors[i], centroids.data(), centroidCount, dimensions);
+            }
+        });
+
+        std::vector<double> sums(centroids.size(), 0.0);
+        std::vector<std::uint32_t> counts(centroidCount, 0u);
+        std::mutex sumsMutex{};
+
+        parallelFor(0u, vectors.size(), [&](std::size_t begin, std::size_t end) {
+            std::vector<double> localSums(centroids.size(), 0.0);
+            std::vector<std::uint32_t> localCounts(centroidCount, 0u);
+
+            for (std::size_t i = begin; i < end; i++)
+            {
+                double* sum = localSums.data() + static_cast<std::size_t>(assignments[i]) * dimensions;
+                for (std::uint32_t d = 0u; d < dimensions; d++)
+                {
+                    sum[d] += vectors[i][d];
+                }
+                localCounts[assignments[i]]++;
+            }
+
+            std::lock_guard<std::mutex> lock(sumsMutex);
+            for (std::size_t j = 0u; j < sums.size(); j++)
+            {
+                sums[j] += localSums[j];
+            }
+            for (std::uint32_t c = 0u; c < centroidCount; c++)
+            {
+                counts[c] += localCounts[c];
+            }
+        });
+
+        // Centroids without any vector are kept.
+        for (std::uint32_t c = 0u; c < centroidCount; c++)
+        {
+            if (counts[c] == 0u)
+            {
+                continue;
+            }
+
+            for (std::uint32_t d = 0u; d < dimensions; d++)
+            {
+                centroids[static_cast<std::size_t>(c) * dimensions + d] = static_cast<float>(sums[static_cast<std::size_t>(c) * dimensions + d] / counts[c]);
+            }
+        }
+    }
+
+    return centroids;
+}
+
+ShPalette buildShPalette(const std::string& binary, std::uint32_t count, std::uint32_t degree, std::uint32_t paletteSize)
+{
+    const std::uint32_t byteStride = getByteStride(degree);
+
+    ShPalette palette{};
+    palette.dimensions = (byteStride - restByteOffset) / sizeof(float);
+    palette.indices.resize(count);
+
+    if (count == 0u || palette.dimensions == 0u)
+    {
+        return palette;
+    }
+
+    auto getVector = [&](std::uint32_t vertex) {
+        return reinterpret_cast<const float*>(binary.data() + static_cast<std::size_t>(byteStride) * vertex + restByteOffset);
+    };
+
+    paletteSize = std::clamp(paletteSize, 1u, count);
+
+    // Approximation by two levels: A coarse codebook and a fine codebook per coarse entry.
+    // Assigning a splat needs coarse plus fine entries distances instead of palette size distances.
+    const std::uint32_t coarseSize = std::max(1u, static_cast<std::uint32_t>(std::sqrt(static_cast<double>(paletteSize))));
+
+    // Shuffled training samples with a fixed seed, so the output is reproducible.
+    std::vector<std::uint32_t> order(count);
+    std::iota(order.begin(), order.end(), 0u);
+    std::shuffle(order.begin(), order.end(), std::mt19937{0u});
+
+    const std::size_t sampleCount = std::min<std::size_t>(count, static_cast<std::size_t>(paletteSize) * samplesPerEntry);
+
+    std::vector<const float*> samples(sampleCount);
+    for (std::size_t i = 0u; i < sampleCount; i++)
+    {
+        samples[i] = getVector(order[i]);
+    }
+
+    std::vector<float> coarse = kMeans(samples, coarseSize, palette.dimensions);
+    const std::uint32_t coarseCount = static_cast<std::uint32_t>(coarse.size() / palette.dimensions);
+
+    std::vector<std::vector<const float*>> coarseSamples(coarseCount);
+    for (const float* sample : samples)
+    {
+        coarseSamples[getNearest(sample, coarse.data(), coarseCount, palette.dimensions)].push_back(sample);
+    }
+
+    // Fine codebooks, each stored in a contiguous range of the palette. Their sizes add up to the palette size, the first ones
+    // having one entry more for the remainder.
+    std::vector<std::vector<float>> fine(coarseCount);
+    std::vector<std::uint32_t> fineOffsets(coarseCount + 1u, 0u);
+    for (std::uint32_t c = 0u; c < coarseCount; c++)
+    {
+        if (coarseSamples[c].empty())
+        {
+            // Coarse centroid itself is the only fine entry.
+            fine[c].assign(coarse.begin() + static_cast<std::size_t>(c) * palette.dimensions, coarse.begin() + static_cast<std::size_t>(c + 1u) * palette.dimensions);
+        }
+        else
+        {
+            const std::uint32_t fineSize = paletteSize / coarseCount + (c < paletteSize % coarseCount ? 1u : 0u);
+
+            fine[c] = kMeans(coarseSamples[c], fineSize, palette.dimensions);
+        }
+
+        fineOffsets[c + 1u] = fineOffsets[c] + static_cast<std::uint32_t>(fine[c].size() / palette.dimensions);
+    }
+
+    palette.size = fineOffsets[coarseCount];
+
+    // Assign all splats and refine the codebook by the mean of all assigned splats.
+    std::vector<double> sums(static_cast<std::size_t>(palette.size) * palette.dimensions, 0.0);
+    std::vector<std::uint32_t> counts(palette.size, 0u);
+    std::mutex sumsMutex{};
+
+    parallelFor(0u, count, [&](std::size_t begin, std::size_t end) {
+        std::vector<double> localSums(sums.size(), 0.0);
+        std::vector<std::uint32_t> localCounts(palette.size, 0u);
+
+        for (std::size_t vertex = begin; vertex < end; vertex++)
+        {
+            const float* vector = getVector(static_cast<std::uint32_t>(vertex));
+
+            const std::uint32_t c = getNearest(vector, coarse.data(), coarseCount, palette.dimensions);
+            const std::uint32_t index = fineOffsets[c] + getNearest(vector, fine[c].data(), fineOffsets[c + 1u] - fineOffsets[c], palette.dimensions);
+
+            palette.indices[vertex] = index;
+
+            double* sum = localSums.data() + static_cast<std::size_t>(index) * palette.dimensions;
+            for (std::uint32_t d = 0u; d < palette.dimensions; d++)
+            {
+                sum[d] += vector[d];
+            }
+            localCounts[index]++;
+        }
+
+        std::lock_guard<std::mutex> lock(sumsMutex);
+        for (std::size_t j = 0u; j < sums.size(); j++)
+        {
+            sums[j] += localSums[j];
+        }
+        for (std::uint32_t i = 0u; i < palette.size; i++)
+        {
+            counts[i] += localCounts[i];
+        }
+    });
+
+    palette.codebook.resize(static_cast<std::size_t>(palette.size) * palette.dimensions);
+    for (std::uint32_t c = 0u; c < coarseCount; c++)
+    {
+        std::copy(fine[c].begin(), fine[c].end(), palette.codebook.begin() + static_cast<std::size_t>(fineOffsets[c]) * palette.dimensions);
+    }
+    for (std::uint32_t i = 0u; i < palette.size; i++)
+    {
+        if (counts[i] == 0u)
+        {
+            continue;
+        }
+
+        for (std::uint32_t d = 0u; d < palette.dimensions; d++)
+        {
+            palette.codebook[static_cast<std::size_t>(i) * palette.dimensions + d] = static_cast<float>(sums[static_cast<std::size_t>(i) * palette.dimensions + d] / counts[i]);
+        }
+    }
+
+    return palette;
+}
+
+json createShPaletteGltf(const std::string& uri, const std::string& binary, std::uint32_t count, std::uint32_t degree, const ShPalette& palette, std::string& output)
+{
+    const std::uint32_t byteStride = getByteStride(degree);
+    const std::uint32_t baseByteStride = getByteStride(0u);
+
+    // Buffer content: Base records, indices and codebook.
+    output.assign(static_cast<std::size_t>(baseByteStride) * count, 0);
+    for (std::uint32_t vertex = 0u; vertex < count; vertex++)
+    {
+        std::memcpy(output.data() + static_cast<std::size_t>(baseByteStride) * vertex, binary.data() + static_cast<std::size_t>(byteStride) * vertex, baseByteStride);
+    }
+
+    json glTF = createGltf(uri, output, count, 0u);
+
+    const std::size_t indicesByteOffset = output.size();
+    output.append(reinterpret_cast<const char*>(palette.indices.data()), palette.indices.size() * sizeof(std::uint32_t));
+
+    const std::size_t codebookByteOffset = output.size();
+    output.append(reinterpret_cast<const char*>(palette.codebook.data()), palette.codebook.size() * sizeof(float));
+
+    glTF["buffers"][0u]["byteLength"] = output.size();
+
+    //
+
+    const std::size_t indicesBufferView = glTF["bufferViews"].size();
+
+    json bufferView = json::object();
+    bufferView["buffer"] = 0;
+    bufferView["byteOffset"] = indicesByteOffset;
+    bufferView["byteLength"] = palette.indices.size() * sizeof(std::uint32_t);
+    bufferView["byteStride"] = sizeof(std::uint32_t);
+    bufferView["target"] = 34962;
+
+    glTF["bufferViews"].push_back(bufferView);
+
+    // Codebook is not a vertex attribute, so it has no target.
+    const std::size_t codebookBufferView = glTF["bufferViews"].size();
+
+    bufferView = json::object();
+    bufferView["buffer"] = 0;
+    bufferView["byteOffset"] = codebookByteOffset;
+    bufferView["byteLength"] = palette.codebook.size() * sizeof(float);
+    bufferView["byteStride"] = palette.dimensions * sizeof(float);
+
+    glTF["bufferViews"].push_back(bufferView);
+
+    //
+
+    json& primitive = glTF["meshes"][0u]["primitives"][0u];
+
+    json extension = json::object();
+    extension["degree"] = degree;
+
+    json accessor = json::object();
+    accessor["name"] = "SH_PALETTE_INDEX";
+    accessor["bufferView"] = indicesBufferView;
+    // Vertex attributes can not be unsigned int, so the low bytes of the little endian indices are read, which hold all of them.
+    accessor["componentType"] = palette.size <= 256u ? 5121 : 5123;
+    accessor["count"] = count;
+    accessor["type"] = "SCALAR";
+
+    primitive["attributes"]["_SH_PALETTE_INDEX"] = glTF["accessors"].size();
+    extension["index"] = glTF["accessors"].size();
+
+    glTF["accessors"].push_back(accessor);
+
+    extension["coefficients"] = json::object();
+
+    std::uint32_t byteOffset{0u};
+    for (std::uint32_t current_l = 1u; current_l <= degree; current_l++)
+    {
+        for (std::uint32_t current_n = 0u; current_n < 1u + 2u * current_l; current_n++)
+        {
+            std::string current_name{"SH_DEGREE_" + std::to_string(current_l) + "_COEF_" + std::to_string(current_n)};
+
+            accessor = json::object();
+            accessor["name"] = "SH_PALETTE_" + current_name;
+            accessor["bufferView"] = codebookBufferView;
+            accessor["byteOffset"] = byteOffset;
+            accessor["componentType"] = 5126;
+            accessor["count"] = palette.size;
+            accessor["type"] = "VEC3";
+
+            extension["coefficients"][current_name] = glTF["accessors"].size();
+
+            glTF["accessors"].push_back(accessor);
+
+            byteOffset += 3u * sizeof(float);
+        }
+    }
+
+    primitive["extensions"]["EXT_gaussian_splatting_sh_palette"] = extension;
+
+    // Viewers not supporting the palette still can render degree 0.
+    glTF["extensionsUsed"].push_back("EXT_gaussian_splatting_sh_palette");
+
+    return glTF;
+}
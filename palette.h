@@ -0,0 +1,32 @@
+#ifndef GLTF_PALETTE_H
+#define GLTF_PALETTE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+// Indices are stored as unsigned short vertex attribute at most.
+constexpr std::uint32_t maxShPaletteSize{65536u};
+
+struct ShPalette
+{
+    // Codebook of the higher degree coefficients, stored like in the interleaved record.
+    std::vector<float> codebook{};
+
+    // Codebook entry per splat.
+    std::vector<std::uint32_t> indices{};
+
+    std::uint32_t size{0u};
+    std::uint32_t dimensions{0u};
+};
+
+// Clusters the higher degree spherical harmonics of all splats by approximate k-means into a codebook of the given size.
+ShPalette buildShPalette(const std::string& binary, std::uint32_t count, std::uint32_t degree, std::uint32_t paletteSize);
+
+// Creates the glTF storing the base attributes per splat and the higher degrees as codebook plus index using EXT_gaussian_splatting_sh_palette.
+// The buffer content is stored into output.
+nlohmann::json createShPaletteGltf(const std::string& uri, const std::string& binary, std::uint32_t count, std::uint32_t degree, const ShPalette& palette, std::string& output);
+
+#endif /*GLTF_PALETTE_H*/
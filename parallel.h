@@ -0,0 +1,98 @@
+#ifndef GLTF_PARALLEL_H
+#define GLTF_PARALLEL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+inline std::uint32_t getThreadCount()
+{
+    std::uint32_t threadCount = std::thread::hardware_concurrency();
+    if (threadCount == 0u)
+    {
+        threadCount = 1u;
+    }
+
+    return threadCount;
+}
+
+// Splits [begin, end) into contiguous ranges and calls function(rangeBegin, rangeEnd) for each range on its own thread.
+template <typename Function>
+void parallelFor(std::size_t begin, std::size_t end, Function function)
+{
+    if (end <= begin)
+    {
+        return;
+    }
+
+    const std::size_t size = end - begin;
+    const std::size_t threadCount = std::min<std::size_t>(getThreadCount(), size);
+    const std::size_t rangeSize = (size + threadCount - 1u) / threadCount;
+
+    std::vector<std::thread> threads{};
+    for (std::size_t rangeBegin = begin + rangeSize; rangeBegin < end; rangeBegin += rangeSize)
+    {
+        threads.emplace_back(function, rangeBegin, std::min(rangeBegin + rangeSize, end));
+    }
+
+    // First range is processed on the calling thread.
+    function(begin, std::min(begin + rangeSize, end));
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+// Sorts ranges of the values on their own thread and merges neighbouring ranges in parallel afterwards.
+template <typename T, typename Compare>
+void parallelSort(std::vector<T>& values, Compare compare)
+{
+    // Below this size per thread, starting threads costs more than sorting.
+    constexpr std::size_t minimalRangeSize{16384u};
+
+    const std::size_t rangeCount = std::min<std::size_t>(getThreadCount(), values.size() / minimalRangeSize);
+    if (rangeCount <= 1u)
+    {
+        std::sort(values.begin(), values.end(), compare);
+
+        return;
+    }
+
+    std::vector<std::size_t> bounds(rangeCount + 1u);
+    for (std::size_t i = 0u; i <= rangeCount; i++)
+    {
+        bounds[i] = values.size() * i / rangeCount;
+    }
+
+    parallelFor(0u, rangeCount, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++)
+        {
+            std::sort(values.begin() + bounds[i], values.begin() + bounds[i + 1u], compare);
+        }
+    });
+
+    for (std::size_t width = 1u; width < rangeCount; width *= 2u)
+    {
+        std::vector<std::thread> threads{};
+        for (std::size_t i = 0u; i + width < rangeCount; i += 2u * width)
+        {
+            auto first = values.begin() + bounds[i];
+            auto middle = values.begin() + bounds[i + width];
+            auto last = values.begin() + bounds[std::min(i + 2u * width, rangeCount)];
+
+            threads.emplace_back([first, middle, last, &compare]() {
+                std::inplace_merge(first, middle, last, compare);
+            });
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+    }
+}
+
+#endif /*GLTF_PARALLEL_H*/
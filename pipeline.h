@@ -0,0 +1,447 @@
+#ifndef GLTF_PIPELINE_H
+#define GLTF_PIPELINE_H
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Depths of a queue between two stages, sampled whenever an item is taken. A mostly full queue shows the consuming stage as
+// bottleneck, a mostly empty one the producing stage.
+struct QueueMetrics
+{
+    std::size_t capacity{0u};
+    std::uint64_t items{0u};
+    double meanDepth{0.0};
+    std::size_t maxDepth{0u};
+    // Times a producer found the queue full or a consumer found it empty and had to wait.
+    std::uint64_t fullWaits{0u};
+    std::uint64_t emptyWaits{0u};
+};
+
+// Read and decoded chunks, vertex ranges to convert and converted ranges to write.
+struct PipelineStats
+{
+    QueueMetrics read{};
+    QueueMetrics convert{};
+    QueueMetrics write{};
+    std::uint32_t workers{0u};
+    // Vertex ranges converted by another worker than the one they were queued for.
+    std::uint64_t steals{0u};
+    // Heap allocations of the workers while converting, which is expected to be zero.
+    std::uint64_t convertAllocations{0u};
+    // The .bin has been written while converting, so it does not have to be saved afterwards.
+    bool binaryWritten{false};
+};
+
+// Collects QueueMetrics from concurrent threads.
+class QueueMonitor
+{
+public:
+    void sample(std::size_t depth)
+    {
+        items.fetch_add(1u, std::memory_order_relaxed);
+        depthSum.fetch_add(depth, std::memory_order_relaxed);
+
+        std::size_t previous = maxDepth.load(std::memory_order_relaxed);
+        while (previous < depth && !maxDepth.compare_exchange_weak(previous, depth, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void full()
+    {
+        fullWaits.fetch_add(1u, std::memory_order_relaxed);
+    }
+
+    void empty()
+    {
+        emptyWaits.fetch_add(1u, std::memory_order_relaxed);
+    }
+
+    QueueMetrics getMetrics(std::size_t capacity) const
+    {
+        QueueMetrics metrics{};
+        metrics.capacity = capacity;
+        metrics.items = items.load(std::memory_order_relaxed);
+        metrics.meanDepth = metrics.items > 0u ? static_cast<double>(depthSum.load(std::memory_order_relaxed)) / static_cast<double>(metrics.items) : 0.0;
+        metrics.maxDepth = maxDepth.load(std::memory_order_relaxed);
+        metrics.fullWaits = fullWaits.load(std::memory_order_relaxed);
+        metrics.emptyWaits = emptyWaits.load(std::memory_order_relaxed);
+
+        return metrics;
+    }
+
+private:
+    std::atomic<std::uint64_t> items{0u};
+    std::atomic<std::uint64_t> depthSum{0u};
+    std::atomic<std::size_t> maxDepth{0u};
+    std::atomic<std::uint64_t> fullWaits{0u};
+    std::atomic<std::uint64_t> emptyWaits{0u};
+};
+
+// Bounded lock-free queue for multiple producers and consumers after Dmitry Vyukov, where every cell carries a sequence number
+// telling, whether it is free for the producer or filled for the consumer of the current round.
+template <typename T>
+class BoundedQueue
+{
+public:
+    // Capacity is rounded up to a power of two.
+    explicit BoundedQueue(std::size_t capacity) :
+        capacity(std::bit_ceil(std::max<std::size_t>(capacity, 2u))),
+        cells(std::make_unique<Cell[]>(this->capacity))
+    {
+        for (std::size_t i = 0u; i < this->capacity; i++)
+        {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Moves from value only on success. Returns false, if the queue is full.
+    bool tryPush(T& value)
+    {
+        std::size_t position = enqueuePosition.load(std::memory_order_relaxed);
+        Cell* cell{nullptr};
+        while (true)
+        {
+            cell = &cells[position & (capacity - 1u)];
+
+            const std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence - position);
+            if (difference == 0 && enqueuePosition.compare_exchange_weak(position, position + 1u, std::memory_order_relaxed))
+            {
+                break;
+            }
+            else if (difference < 0)
+            {
+                return false;
+            }
+            else if (difference > 0)
+            {
+                position = enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->value = std::move(value);
+        cell->sequence.store(position + 1u, std::memory_order_release);
+
+        pushes.fetch_add(1u, std::memory_order_release);
+        pushes.notify_all();
+
+        return true;
+    }
+
+    // Returns false, if the queue is empty.
+    bool tryPop(T& value)
+    {
+        std::size_t position = dequeuePosition.load(std::memory_order_relaxed);
+        Cell* cell{nullptr};
+        while (true)
+        {
+            cell = &cells[position & (capacity - 1u)];
+
+            const std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence - (position + 1u));
+            if (difference == 0 && dequeuePosition.compare_exchange_weak(position, position + 1u, std::memory_order_relaxed))
+            {
+                break;
+            }
+            else if (difference < 0)
+            {
+                return false;
+            }
+            else if (difference > 0)
+            {
+                position = dequeuePosition.load(std::memory_order_relaxed);
+            }
+        }
+
+        value = std::move(cell->value);
+        cell->sequence.store(position + capacity, std::memory_order_release);
+
+        pops.fetch_add(1u, std::memory_order_release);
+        pops.notify_all();
+
+        return true;
+    }
+
+    // Blocks while the queue is full. Returns false, if the queue has been closed.
+    bool push(T value)
+    {
+        while (!closed.load(std::memory_order_acquire))
+        {
+            const std::uint32_t signal = pops.load(std::memory_order_acquire);
+            if (tryPush(value))
+            {
+                return true;
+            }
+
+            monitor.full();
+            pops.wait(signal, std::memory_order_acquire);
+        }
+
+        return false;
+    }
+
+    // Blocks while the queue is empty. Returns false, after the last item of a closed queue has been taken.
+    bool pop(T& value)
+    {
+        while (true)
+        {
+            const std::uint32_t signal = pushes.load(std::memory_order_acquire);
+            const bool last = closed.load(std::memory_order_acquire);
+
+            const std::size_t depth = getDepth();
+            if (tryPop(value))
+            {
+                monitor.sample(depth);
+
+                return true;
+            }
+
+            if (last)
+            {
+                return false;
+            }
+
+            monitor.empty();
+            pushes.wait(signal, std::memory_order_acquire);
+        }
+    }
+
+    // No further items are accepted. Wakes all blocked producers and consumers.
+    void close()
+    {
+        closed.store(true, std::memory_order_release);
+
+        pushes.fetch_add(1u, std::memory_order_release);
+        pushes.notify_all();
+        pops.fetch_add(1u, std::memory_order_release);
+        pops.notify_all();
+    }
+
+    bool isClosed() const
+    {
+        return closed.load(std::memory_order_acquire);
+    }
+
+    // Approximate, as producers and consumers can be concurrent.
+    std::size_t getDepth() const
+    {
+        const std::size_t dequeued = dequeuePosition.load(std::memory_order_relaxed);
+        const std::size_t enqueued = enqueuePosition.load(std::memory_order_relaxed);
+
+        return enqueued > dequeued ? std::min(enqueued - dequeued, capacity) : 0u;
+    }
+
+    std::size_t getCapacity() const
+    {
+        return capacity;
+    }
+
+    QueueMetrics getMetrics() const
+    {
+        return monitor.getMetrics(capacity);
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<std::size_t> sequence{0u};
+        T value{};
+    };
+
+    const std::size_t capacity;
+    std::unique_ptr<Cell[]> cells;
+
+    // Separate cache lines, so producers and consumers do not invalidate each other.
+    alignas(64) std::atomic<std::size_t> enqueuePosition{0u};
+    alignas(64) std::atomic<std::size_t> dequeuePosition{0u};
+
+    // Changed on every push, pop and close, so blocked threads can wait for it.
+    alignas(64) std::atomic<std::uint32_t> pushes{0u};
+    alignas(64) std::atomic<std::uint32_t> pops{0u};
+
+    std::atomic<bool> closed{false};
+
+    QueueMonitor monitor{};
+};
+
+// Runs tasks on worker threads, each taking from its own bounded queue first. Idle workers steal tasks from the queues of the
+// others, so a worker held up e.g. by page faults does not stall the stage. Submitting blocks while all queues are full.
+template <typename Task>
+class WorkStealingPool
+{
+public:
+    WorkStealingPool(std::uint32_t workerCount, std::size_t capacity, std::function<void(Task&)> function) :
+        function(std::move(function))
+    {
+        workerCount = std::max(workerCount, 1u);
+
+        for (std::uint32_t i = 0u; i < workerCount; i++)
+        {
+            queues.push_back(std::make_unique<BoundedQueue<Task>>(capacity));
+        }
+
+        for (std::uint32_t i = 0u; i < workerCount; i++)
+        {
+            threads.emplace_back(&WorkStealingPool::work, this, i);
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    ~WorkStealingPool()
+    {
+        finish();
+    }
+
+    // Queues the task round robin, or to the next queue having space.
+    void submit(Task task)
+    {
+        while (true)
+        {
+            const std::uint32_t signal = taken.load(std::memory_order_acquire);
+
+            for (std::size_t i = 0u; i < queues.size(); i++)
+            {
+                const std::size_t index = (next + i) % queues.size();
+                if (queues[index]->tryPush(task))
+                {
+                    next = (index + 1u) % queues.size();
+
+                    submitted.fetch_add(1u, std::memory_order_release);
+                    submitted.notify_all();
+
+                    return;
+                }
+            }
+
+            monitor.full();
+            taken.wait(signal, std::memory_order_acquire);
+        }
+    }
+
+    // Waits for all submitted tasks and stops the workers.
+    void finish()
+    {
+        if (threads.empty())
+        {
+            return;
+        }
+
+        finishing.store(true, std::memory_order_release);
+        submitted.fetch_add(1u, std::memory_order_release);
+        submitted.notify_all();
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+        threads.clear();
+    }
+
+    std::uint32_t getWorkerCount() const
+    {
+        return static_cast<std::uint32_t>(queues.size());
+    }
+
+    std::uint64_t getSteals() const
+    {
+        return steals.load(std::memory_order_relaxed);
+    }
+
+    // Depth over the queues of all workers.
+    QueueMetrics getMetrics() const
+    {
+        return monitor.getMetrics(queues.size() * queues[0]->getCapacity());
+    }
+
+private:
+    std::size_t getDepth() const
+    {
+        std::size_t depth{0u};
+        for (const auto& queue : queues)
+        {
+            depth += queue->getDepth();
+        }
+
+        return depth;
+    }
+
+    bool take(std::uint32_t worker, Task& task)
+    {
+        const std::size_t depth = getDepth();
+
+        bool success = queues[worker]->tryPop(task);
+        for (std::size_t i = 1u; !success && i < queues.size(); i++)
+        {
+            success = queues[(worker + i) % queues.size()]->tryPop(task);
+            if (success)
+            {
+                steals.fetch_add(1u, std::memory_order_relaxed);
+            }
+        }
+
+        if (success)
+        {
+            monitor.sample(depth);
+
+            taken.fetch_add(1u, std::memory_order_release);
+            taken.notify_all();
+        }
+
+        return success;
+    }
+
+    void work(std::uint32_t worker)
+    {
+        while (true)
+        {
+            const std::uint32_t signal = submitted.load(std::memory_order_acquire);
+            // All tasks have been queued, before finishing is set.
+            const bool last = finishing.load(std::memory_order_acquire);
+
+            Task task{};
+            if (take(worker, task))
+            {
+                function(task);
+
+                continue;
+            }
+
+            if (last)
+            {
+                return;
+            }
+
+            monitor.empty();
+            submitted.wait(signal, std::memory_order_acquire);
+        }
+    }
+
+    std::function<void(Task&)> function;
+    std::vector<std::unique_ptr<BoundedQueue<Task>>> queues{};
+    std::vector<std::thread> threads{};
+
+    // Only used by the submitting thread.
+    std::size_t next{0u};
+
+    // Changed on every submitted and taken task, so idle workers and a blocked submitter can wait for it.
+    alignas(64) std::atomic<std::uint32_t> submitted{0u};
+    alignas(64) std::atomic<std::uint32_t> taken{0u};
+
+    std::atomic<bool> finishing{false};
+    std::atomic<std::uint64_t> steals{0u};
+
+    QueueMonitor monitor{};
+};
+
+#endif /*GLTF_PIPELINE_H*/
@@ -0,0 +1,478 @@
+#include "plan.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "bands.h"
+#include "dump.h"
+#include "gltf.h"
+#include "input.h"
+#include "palette.h"
+#include "parallel.h"
+#include "ply.h"
+
+using json = nlohmann::json;
+
+//
+// Throughput of the conversion steps, calibrated with a release build on one core and the input in the page cache.
+//
+
+// Bytes of PLY data per millisecond, read or decompressed.
+constexpr double plyThroughput{480000.0};
+constexpr double gzipThroughput{75000.0};
+constexpr double zstdThroughput{160000.0};
+
+// Splats per millisecond decoded from .splat and .spz.
+constexpr double splatThroughput{1800.0};
+constexpr double spzThroughput{540.0};
+
+// Bytes per millisecond written.
+constexpr double saveThroughput{1000000.0};
+constexpr double dumpThroughput{110000.0};
+
+// Milliseconds per splat of the processing steps, which all run in parallel.
+constexpr double dedupeCost{0.002};
+// Per neighbor.
+constexpr double floaterCost{0.0012};
+constexpr double importanceCost{0.0003};
+constexpr double tilesCost{0.0002};
+// Per level of detail.
+constexpr double lodCost{0.0007};
+// Per dimension of the higher degree coefficients and doubling of the palette size.
+constexpr double paletteCost{0.000012};
+
+// Layouts, which are not requested, are estimated with these settings.
+constexpr std::uint32_t defaultPaletteSize{4096u};
+constexpr std::uint32_t defaultLevels{3u};
+
+// Smallest prefix added by --progressive, see progressive.cpp.
+constexpr std::uint32_t minimalPrefixCount{256u};
+
+// Chunks of 4 MiB in flight while streaming, see input.cpp: the read queue, the ones being read and split, and per worker
+// the queued ones and the converted one.
+constexpr std::size_t chunkByteLength{4u * 1024u * 1024u};
+constexpr std::size_t streamingChunks{4u + 2u};
+constexpr std::size_t streamingChunksPerWorker{2u + 1u};
+
+// Bytes per splat of the inflated .spz columns without the spherical harmonics.
+constexpr std::size_t spzByteStride{9u + 1u + 3u + 3u + 3u};
+
+// Bytes per splat added by --precompute, see precompute.cpp.
+constexpr std::size_t precomputedByteStride{6u * sizeof(float) + 4u};
+
+// Texture layout of --textures, see texture.cpp. Bytes per texel of position, rotation, scale, opacity and base color.
+constexpr std::size_t textureBlockSize{16u};
+constexpr std::size_t textureByteStride{6u + 4u + 3u + 1u + 3u};
+
+// Upper bound of the header of --compressed-ply, see dump.cpp.
+constexpr std::size_t compressedHeaderByteLength{2048u};
+
+// Bytes per splat of the cleanup, the grid entry and the opacities, targets and distances.
+constexpr std::size_t cleanupByteStride{24u + 1u + 1u + 4u + 4u + 4u + 4u};
+
+static std::uint32_t getCoefficients(std::uint32_t degree)
+{
+    return (degree + 1u) * (degree + 1u) - 1u;
+}
+
+// Sets the counts and byte lengths of a glTF, which has been created from a single record, to the expected ones.
+static std::size_t getGltfByteLength(json& glTF, std::uint32_t count, std::size_t binaryByteLength)
+{
+    // Bounds with a typical amount of digits.
+    const float bounds[3]{-123.456789f, 12.3456789f, 1.23456789f};
+
+    for (json& accessor : glTF["accessors"])
+    {
+        accessor["count"] = std::max(count, accessor["count"].get<std::uint32_t>());
+
+        if (accessor.contains("min"))
+        {
+            accessor["min"] = json::array({bounds[0], bounds[1], bounds[2]});
+            accessor["max"] = json::array({bounds[2], bounds[1], bounds[0]});
+        }
+    }
+    for (json& bufferView : glTF["bufferViews"])
+    {
+        bufferView["byteLength"] = binaryByteLength;
+    }
+    glTF["buffers"][0]["byteLength"] = binaryByteLength;
+
+    return glTF.dump(3).size();
+}
+
+// Size of the glTF of the interleaved splats with the given amount of meshes, each with its own accessors.
+static std::size_t getGltfByteLength(const std::string& uri, std::uint32_t count, std::uint32_t degree, std::size_t binaryByteLength, std::size_t meshes)
+{
+    const std::string record(getByteStride(degree), '\0');
+
+    json glTF = createGltf(uri, record, 1u, degree);
+    for (std::size_t mesh = 1u; mesh < meshes; mesh++)
+    {
+        addMesh(glTF, 0u, record, 1u, degree);
+    }
+
+    return getGltfByteLength(glTF, count, binaryByteLength);
+}
+
+// Amount of buffers the binary is split into, at whole records.
+static std::size_t getBufferCount(std::size_t binaryByteLength, std::uint32_t byteStride, std::size_t maxBufferSize)
+{
+    if (binaryByteLength <= maxBufferSize)
+    {
+        return 1u;
+    }
+
+    const std::size_t partByteLength = std::max<std::size_t>(maxBufferSize / byteStride, 1u) * byteStride;
+
+    return (binaryByteLength + partByteLength - 1u) / partByteLength;
+}
+
+// Splat counts of the levels, which are added by --lod or --progressive, each a quarter of the previous one.
+static std::vector<std::uint32_t> getLevelCounts(std::uint32_t count, std::uint32_t levels, std::uint32_t minimalCount)
+{
+    std::vector<std::uint32_t> levelCounts{};
+
+    std::uint32_t levelCount{count};
+    for (std::uint32_t level = 0u; level < levels; level++)
+    {
+        levelCount /= 4u;
+        if (levelCount < minimalCount)
+        {
+            break;
+        }
+
+        levelCounts.push_back(levelCount);
+    }
+
+    return levelCounts;
+}
+
+static json createLayout(const char* name, std::size_t gltfByteLength, std::size_t binaryByteLength, std::size_t buffers)
+{
+    json layout = json::object();
+    layout["layout"] = name;
+    layout["gltfBytes"] = gltfByteLength;
+    layout["binBytes"] = binaryByteLength;
+    layout["buffers"] = buffers;
+
+    return layout;
+}
+
+bool planConversion(const ConversionOptions& options)
+{
+    const std::string& loadname{options.filename};
+
+    const InputFormat inputFormat = getInputFormat(loadname);
+    if (loadname == "-" || inputFormat == InputFormat::GLTF || inputFormat == InputFormat::GLB)
+    {
+        printf("Error: --plan requires a PLY, .splat or .spz file\n");
+
+        return false;
+    }
+
+    if (!isInputFormatSupported(inputFormat))
+    {
+        printf("Error: Format of '%s' is not supported by this build\n", loadname.c_str());
+
+        return false;
+    }
+
+    std::error_code error{};
+    const std::uintmax_t inputByteLength = std::filesystem::file_size(loadname, error);
+    if (error)
+    {
+        printf("Error: Could not load '%s'\n", loadname.c_str());
+
+        return false;
+    }
+
+    PlyHeader header{};
+    if (!readInputHeader(loadname, inputFormat, header))
+    {
+        printf("Error: Can not process `%s` file\n", loadname.c_str());
+
+        return false;
+    }
+
+    if (inputFormat == InputFormat::PLY && inputByteLength - header.byteLength < static_cast<std::uintmax_t>(header.sourceByteStride) * header.count)
+    {
+        printf("Error: `%s` file is truncated\n", loadname.c_str());
+
+        return false;
+    }
+
+    std::filesystem::path loadpath(loadname);
+    auto stem = loadpath.stem().generic_string();
+    if (inputFormat == InputFormat::PLY_GZIP || inputFormat == InputFormat::PLY_ZSTD)
+    {
+        stem = std::filesystem::path(stem).stem().generic_string();
+    }
+    const std::string uri{stem + ".bin"};
+
+    // Removed duplicates and floaters are not known in advance, so all estimates are upper bounds.
+    const std::uint32_t count{header.count};
+    const std::uint32_t degree{header.degree};
+    const std::uint32_t byteStride = getByteStride(degree);
+    const std::size_t binaryByteLength = static_cast<std::size_t>(byteStride) * count;
+
+    const double threads = static_cast<double>(getThreadCount());
+
+    //
+    // Output layouts
+    //
+
+    json layouts = json::array();
+
+    const std::size_t buffers = getBufferCount(binaryByteLength, byteStride, options.maxBufferSize);
+    const json interleaved = createLayout("interleaved", getGltfByteLength(uri, count, degree, binaryByteLength, buffers), binaryByteLength, buffers);
+    layouts.push_back(interleaved);
+
+    // Binary chunk padded to 4 bytes, GLB and chunk headers.
+    const std::size_t glbByteLength = 12u + 8u + (interleaved["gltfBytes"].get<std::size_t>() + 3u) / 4u * 4u + 8u + (binaryByteLength + 3u) / 4u * 4u;
+
+    json glb = json::object();
+    glb["layout"] = "glb";
+    glb["glbBytes"] = glbByteLength;
+    glb["supported"] = glbByteLength <= 0xffffffffull;
+    layouts.push_back(glb);
+
+    const std::uint32_t paletteSize = std::min(options.shPalette > 0u ? options.shPalette : defaultPaletteSize, std::max(count, 1u));
+    std::size_t paletteByteLength{binaryByteLength};
+    if (degree > 0u)
+    {
+        const std::string record(byteStride, '\0');
+
+        ShPalette palette{};
+        palette.size = 1u;
+        palette.dimensions = 3u * getCoefficients(degree);
+        palette.codebook.assign(palette.dimensions, 0.0f);
+        palette.indices.assign(1u, 0u);
+
+        std::string output{};
+        json glTF = createShPaletteGltf(uri, record, 1u, degree, palette, output);
+
+        paletteByteLength = static_cast<std::size_t>(getByteStride(0u) + sizeof(std::uint32_t)) * count + static_cast<std::size_t>(paletteSize) * palette.dimensions * sizeof(float);
+
+        json layout = createLayout("shPalette", getGltfByteLength(glTF, count, paletteByteLength), paletteByteLength, 1u);
+        layout["entries"] = paletteSize;
+        layouts.push_back(layout);
+    }
+
+    // Base attributes and every higher band of --sh-bands in buffers of their own, in total as large as the interleaved ones.
+    if (degree > 0u)
+    {
+        const std::string record(byteStride, '\0');
+
+        std::vector<std::string> bandBuffers{};
+        json glTF = createShBandsGltf(uri, record, 1u, degree, bandBuffers);
+
+        json layout = createLayout("shBands", getGltfByteLength(glTF, count, binaryByteLength), binaryByteLength, degree + 1u);
+        layout["baseBytes"] = static_cast<std::size_t>(getByteStride(0u)) * count;
+        layouts.push_back(layout);
+    }
+
+    const std::vector<std::uint32_t> lodCounts = getLevelCounts(count, options.lod > 0u ? options.lod : defaultLevels, 1u);
+    std::size_t lodByteLength{binaryByteLength};
+    for (std::uint32_t lodCount : lodCounts)
+    {
+        lodByteLength += static_cast<std::size_t>(byteStride) * lodCount;
+    }
+    {
+        const std::size_t lodBuffers = getBufferCount(lodByteLength, byteStride, options.maxBufferSize);
+
+        json layout = createLayout("lod", getGltfByteLength(uri, count, degree, lodByteLength, lodCounts.size() + lodBuffers), lodByteLength, lodBuffers);
+        layout["levels"] = lodCounts.size();
+        layouts.push_back(layout);
+    }
+
+    const std::vector<std::uint32_t> prefixCounts = getLevelCounts(count, options.progressiveLevels > 0u ? options.progressiveLevels : defaultLevels, minimalPrefixCount);
+    {
+        json layout = createLayout("progressive", getGltfByteLength(uri, count, degree, binaryByteLength, prefixCounts.size() + buffers), binaryByteLength, buffers);
+        layout["levels"] = prefixCounts.size();
+        layouts.push_back(layout);
+    }
+
+    // Raw texels of --textures, in addition to the interleaved layout. PNG images are smaller by their compression.
+    std::size_t textureWidth{textureBlockSize};
+    while (static_cast<std::uint64_t>(textureWidth) * textureWidth < count)
+    {
+        textureWidth *= 2u;
+    }
+    const std::size_t textureBlocks = (static_cast<std::size_t>(count) + textureBlockSize * textureBlockSize - 1u) / (textureBlockSize * textureBlockSize);
+    const std::size_t textureHeight = std::max<std::size_t>((textureBlocks * textureBlockSize + textureWidth - 1u) / textureWidth, 1u) * textureBlockSize;
+    const std::size_t textureByteLength = textureWidth * textureHeight * (textureByteStride + 3u * getCoefficients(degree));
+    {
+        json layout = createLayout("textures", 0u, textureByteLength, 3u + 2u + getCoefficients(degree));
+        layout["width"] = textureWidth;
+        layout["height"] = textureHeight;
+        layouts.push_back(layout);
+    }
+
+    // Compressed PLY of --compressed-ply, in addition to the selected layout.
+    const std::size_t compressedByteLength = compressedHeaderByteLength + (static_cast<std::size_t>(count) + 255u) / 256u * 18u * sizeof(float) + static_cast<std::size_t>(count) * (4u * sizeof(std::uint32_t) + 3u * getCoefficients(degree));
+    {
+        json layout = createLayout("compressedPly", 0u, compressedByteLength, 1u);
+        layouts.push_back(layout);
+    }
+
+    if (options.tiles > 0u)
+    {
+        // Octree leaves are about half full, each with its own glTF and .bin.
+        const std::size_t tiles = std::max<std::size_t>((2u * static_cast<std::size_t>(count) + options.tiles - 1u) / options.tiles, 1u);
+        const std::size_t tilesByteLength = options.lod > 0u ? lodByteLength : binaryByteLength;
+
+        json layout = createLayout("tiles", tiles * getGltfByteLength(uri, options.tiles, degree, tilesByteLength / tiles, 1u), tilesByteLength, tiles);
+        layout["tiles"] = tiles;
+        layouts.push_back(layout);
+    }
+
+    //
+    // Selected layout
+    //
+
+    std::string selectedName{"interleaved"};
+    if (options.tiles > 0u)
+    {
+        selectedName = "tiles";
+    }
+    else if (options.shPalette > 0u && degree > 0u)
+    {
+        selectedName = "shPalette";
+    }
+    else if (options.shBands && degree > 0u)
+    {
+        selectedName = "shBands";
+    }
+    else if (options.lod > 0u)
+    {
+        selectedName = "lod";
+    }
+    else if (options.progressiveLevels > 0u)
+    {
+        selectedName = "progressive";
+    }
+
+    const json& selected = *std::find_if(layouts.begin(), layouts.end(), [&](const json& layout) {
+        return layout["layout"] == selectedName;
+    });
+
+    const std::size_t dumpByteLength = options.dump ? createPlyHeader(count, degree).size() + binaryByteLength : 0u;
+
+    // Attributes of prefix levels are shared, the ones of merged levels are not counted.
+    const std::size_t precomputedByteLength = options.precompute ? precomputedByteStride * count : 0u;
+
+    const std::size_t outputByteLength = selected["gltfBytes"].get<std::size_t>() + selected["binBytes"].get<std::size_t>() + precomputedByteLength + (options.textures.empty() ? 0u : textureByteLength) + (options.compressedPly ? compressedByteLength : 0u) + dumpByteLength;
+
+    //
+    // Peak memory and duration
+    //
+
+    // Buffers kept during the whole conversion: the streamed chunks and the interleaved records.
+    std::size_t baseByteLength{binaryByteLength + precomputedByteLength + (streamingChunks + streamingChunksPerWorker * getThreadCount()) * chunkByteLength};
+    double load{0.0};
+    if (inputFormat == InputFormat::PLY)
+    {
+        load = static_cast<double>(inputByteLength) / plyThroughput;
+    }
+    else
+    {
+        const double plyByteLength = static_cast<double>(header.sourceByteStride) * count;
+        if (inputFormat == InputFormat::PLY_GZIP)
+        {
+            load = plyByteLength / gzipThroughput;
+        }
+        else if (inputFormat == InputFormat::PLY_ZSTD)
+        {
+            load = plyByteLength / zstdThroughput;
+        }
+        else if (inputFormat == InputFormat::SPLAT)
+        {
+            load = count / splatThroughput;
+        }
+        else
+        {
+            // All columns are inflated at once.
+            baseByteLength += (spzByteStride + 3u * getCoefficients(degree)) * static_cast<std::size_t>(count);
+            load = count / spzThroughput;
+        }
+    }
+
+    // Additional memory of the steps, which are run one after another.
+    std::size_t stepByteLength{0u};
+    double process{0.0};
+
+    if (options.dedupeTolerance > 0.0f || options.floaterNeighbors > 0u)
+    {
+        stepByteLength = std::max(stepByteLength, cleanupByteStride * count + binaryByteLength);
+        process += (options.dedupeTolerance > 0.0f ? dedupeCost : 0.0) * count + floaterCost * options.floaterNeighbors * count;
+    }
+    if (options.importanceOrder || options.progressiveLevels > 0u)
+    {
+        stepByteLength = std::max(stepByteLength, 8u * static_cast<std::size_t>(count) + binaryByteLength);
+        process += importanceCost * count;
+    }
+    if (options.tiles > 0u)
+    {
+        stepByteLength = std::max(stepByteLength, 4u * static_cast<std::size_t>(count) + binaryByteLength);
+        process += tilesCost * count;
+    }
+    if (options.lod > 0u)
+    {
+        // Merged levels are appended to the records.
+        stepByteLength = std::max(stepByteLength, 4u * static_cast<std::size_t>(count) + 2u * (lodByteLength - binaryByteLength));
+        process += lodCost * count * static_cast<double>(lodCounts.size());
+    }
+    if (options.shPalette > 0u && degree > 0u)
+    {
+        stepByteLength = std::max(stepByteLength, paletteByteLength);
+        process += paletteCost * count * 3.0 * getCoefficients(degree) * std::log2(static_cast<double>(paletteSize));
+    }
+    if (options.shBands)
+    {
+        // Band buffers are a copy of the records.
+        stepByteLength = std::max(stepByteLength, binaryByteLength);
+    }
+    if (options.dump)
+    {
+        stepByteLength = std::max(stepByteLength, dumpByteLength);
+    }
+    if (options.compressedPly)
+    {
+        // Sorted copy of the records and Morton codes, followed by the compressed PLY.
+        stepByteLength = std::max(stepByteLength, std::max(binaryByteLength + 16u * static_cast<std::size_t>(count), compressedByteLength));
+    }
+
+    process /= threads;
+
+    const double save = static_cast<double>(outputByteLength - dumpByteLength) / saveThroughput + static_cast<double>(dumpByteLength) / dumpThroughput;
+
+    //
+
+    json plan = json::object();
+    plan["filename"] = loadname;
+    plan["inputBytes"] = inputByteLength;
+    plan["count"] = count;
+    plan["degree"] = degree;
+    plan["byteStride"] = byteStride;
+    plan["sourceByteStride"] = header.sourceByteStride;
+    plan["layouts"] = layouts;
+    plan["selectedLayout"] = selected["layout"];
+    plan["outputBytes"] = outputByteLength;
+    plan["peakMemoryBytes"] = baseByteLength + stepByteLength;
+    plan["threads"] = getThreadCount();
+    plan["loadMilliseconds"] = load;
+    plan["processMilliseconds"] = process;
+    plan["saveMilliseconds"] = save;
+    plan["totalMilliseconds"] = load + process + save;
+
+    printf("%s\n", plan.dump(4).c_str());
+
+    return true;
+}
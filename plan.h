@@ -0,0 +1,10 @@
+#ifndef GLTF_PLAN_H
+#define GLTF_PLAN_H
+
+#include "conversion.h"
+
+// Prints a JSON estimate of the conversion configured by the options, derived from the input header only: splat count, spherical
+// harmonics degree, byteStride, output sizes of the available layouts, peak memory and duration. Nothing is converted or written.
+bool planConversion(const ConversionOptions& options);
+
+#endif /*GLTF_PLAN_H*/
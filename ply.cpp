@@ -0,0 +1,484 @@
+#include "ply.h"
+
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <vector>
+
+#include "gltf.h"
+
+// Wigner D-matrix for degree 1 (rotation around x-axis by -90° starting with negative index)
+constexpr double d1_neg90[3][3] = {
+    { 0.f,  -1.f,  0.f },
+    { 1.f,  0.f,  0.f },
+    { 0.f,  0.f,  1.f }
+};
+
+// Wigner D-matrix for degree 2 (rotation around x-axis by -90° starting with negative index)
+constexpr double d2_neg90[5][5] = {
+    { 0.f,  0.f,  0.f,  -1.f,  0.f },
+    { 0.f, -1.f,  0.f,  0.f,  0.f },
+    { 0.f,  0.f, -0.5f, 0.f, -0.866025403f },
+    { 1.f,  0.f,  0.f,  0.f,  0.f },
+    { 0.f,  0.f, -0.866025403f, 0.f,  0.5f }
+};
+
+// Wigner D-matrix for degree 3 (rotation around x-axis by -90° starting with negative index)
+constexpr double d3_neg90[7][7] = {
+    { 0.f, 0.f, 0.f, 0.79056942f, 0.f, -0.61237244f, 0.f},
+    { 0.f, -1.f, 0.f, 0.f, 0.f, 0.f, 0.f },
+    { 0.f,  0.f, 0.f, 0.61237244, 0.f, 0.79056942f, 0.f },
+    { -0.79056942f, 0.f, -0.61237244, -0.f, 0.f, 0.f, -0.f},
+    { 0.f, 0.f, 0.f, 0.f, -0.25f, 0.f, -0.96824584 },
+    { 0.61237244f, 0.f, -0.79056942f, -0.f, 0.f, 0.f, 0.f},
+    { 0.f, 0.f, 0.f, 0.f, -0.96824584f, 0.f, 0.25f  }
+};
+
+// Maximum number of coefficients per color channel, which is reached for degree 3.
+constexpr std::uint32_t maxCoefficients{3u + 5u + 7u};
+
+static void rotateSH_XAxisNeg90(const float* coefficients, std::uint32_t l, float* result)
+{
+    if (l >= 1u)
+    {
+        const double in[3u]{coefficients[0u], coefficients[1u], coefficients[2u]};
+        double out[3u]{};
+
+        for (std::uint32_t i = 0u; i < 3u; i++)
+        {
+            for (std::uint32_t j = 0u; j < 3u; j++)
+            {
+                out[i] += d1_neg90[i][j] * in[j];
+            }
+
+            result[i] = static_cast<float>(out[i]);
+        }
+    }
+    
+    if (l >= 2u)
+    {
+        const double in[5u]{coefficients[3u + 0u], coefficients[3u + 1u], coefficients[3u + 2u], coefficients[3u + 3u], coefficients[3u + 4u]};
+        double out[5u]{};
+
+        for (std::uint32_t i = 0u; i < 5u; i++)
+        {
+            for (std::uint32_t j = 0u; j < 5u; j++)
+            {
+                out[i] += d2_neg90[i][j] * in[j];
+            }
+
+            result[3u + i] = static_cast<float>(out[i]);
+        }
+    }
+    
+    if (l >= 3u)
+    {
+        const double in[7u]{coefficients[3u + 5u + 0u], coefficients[3u + 5u + 1u], coefficients[3u + 5u + 2u], coefficients[3u + 5u + 3u], coefficients[3u + 5u + 4u], coefficients[3u + 5u + 5u], coefficients[3u + 5u + 6u]};
+        double out[7u]{};
+
+        for (std::uint32_t i = 0u; i < 7u; i++)
+        {
+            for (std::uint32_t j = 0u; j < 7u; j++)
+            {
+                out[i] += d3_neg90[i][j] * in[j];
+            }
+
+            result[3u + 5u + i] = static_cast<float>(out[i]);
+        }
+    }
+}
+
+static void gather(const float* coefficients, std::uint32_t l, float* result)
+{
+    std::uint32_t size{0u};
+    for (std::uint32_t current_l = 1u; current_l <= l; current_l++)
+    {
+        size += 1u + 2u * current_l;
+    }
+
+    for (std::uint32_t i = 0u; i < size; i++)
+    {
+        result[i] = coefficients[i];
+    }
+}
+
+// Quaternion multiplication: result = q1 * q0, Indices: 0=x, 1=y, 2=z, 3=w
+static std::array<float, 4u> multiplyQuaternions(const std::array<float, 4u>& q1, const std::array<float, 4u>& q0)
+{
+    std::array<float, 4u> result;
+    
+    result[0] = q1[3]*q0[0] + q1[0]*q0[3] + q1[1]*q0[2] - q1[2]*q0[1]; // x
+    result[1] = q1[3]*q0[1] - q1[0]*q0[2] + q1[1]*q0[3] + q1[2]*q0[0]; // y  
+    result[2] = q1[3]*q0[2] + q1[0]*q0[1] - q1[1]*q0[0] + q1[2]*q0[3]; // z
+    result[3] = q1[3]*q0[3] - q1[0]*q0[0] - q1[1]*q0[1] - q1[2]*q0[2]; // w
+    
+    return result;
+}
+
+bool parsePlyHeader(const std::string& ply, PlyHeader& header)
+{
+    auto index = ply.find("end_header\n");
+    if (index == std::string::npos)
+    {
+        printf("Error: No header found\n");
+
+        return false;
+    }
+
+    header.byteLength = index + 11u;
+
+    // Extracted header required to setup the accessors from PLY.
+    std::istringstream headerStream{ply.substr(0, header.byteLength)};
+
+    std::uint32_t count{0u};
+
+    bool isPly{false};
+    bool isBinaryLittleEndian{false};
+
+    std::uint32_t sourceByteStride{0u};
+    std::map<Attributes, std::uint32_t> sourceByteOffsets{};
+
+    std::uint32_t rests{0u};
+
+    std::string line{};
+    while (std::getline(headerStream, line))
+    {
+        if (line == "ply")
+        {
+            isPly = true;
+        }
+        else if (line.find("format binary_little_endian") != std::string::npos)
+        {
+            isBinaryLittleEndian = true;
+        }
+        else if (line.find("element vertex") != std::string::npos)
+        {
+            auto result = std::sscanf(line.c_str(), "element vertex %u", &count);
+            if (result < 0)
+            {
+                return false;
+            }
+        }
+        else if (line.find("comment") != std::string::npos)
+        {
+            continue;
+        }
+        else if (line == "end_header")
+        {
+            break;
+        }
+        else if (line.starts_with("property "))
+        {
+            char componentType[256u];
+            char name[256u];
+
+            auto result = std::sscanf(line.c_str(), "property %255s %255s", componentType, name);
+            if (result < 0)
+            {
+                printf("Error: Failed to parse property line: '%s'\n", line.c_str());
+                return false;
+            }
+
+            std::string checkComponentType{componentType};
+            if (checkComponentType != "float")
+            {
+                printf("Error: Unknown component type '%s'\n", checkComponentType.c_str());
+
+                return false;
+            }
+
+            std::string checkName{name};
+
+            if (checkName == "nx")
+            {
+                // Not storing, however source byte stride needs to be adapted.
+                sourceByteStride += 3u * sizeof(float);
+
+                continue;
+            }
+            else if (checkName == "x")
+            {
+                sourceByteOffsets[Attributes::POSITION] = sourceByteStride;
+
+                sourceByteStride += 3u * sizeof(float);
+            }
+            else if (checkName == "rot_0")
+            {
+                sourceByteOffsets[Attributes::ROTATION] = sourceByteStride;
+
+                sourceByteStride += 4u * sizeof(float);
+            }
+            else if (checkName == "scale_0")
+            {
+                sourceByteOffsets[Attributes::SCALE] = sourceByteStride;
+
+                sourceByteStride += 3u * sizeof(float);
+            }
+            else if (checkName == "opacity")
+            {
+                sourceByteOffsets[Attributes::OPACITY] = sourceByteStride;
+            
+                sourceByteStride += 1u * sizeof(float);
+            }
+            else if (checkName == "f_dc_0")
+            {
+                sourceByteOffsets[Attributes::SH_DEGREE_0_COEF_0] = sourceByteStride;
+
+                sourceByteStride += 3u * sizeof(float);
+            }
+            else if (checkName == "f_rest_0")
+            {
+                sourceByteOffsets[SH_DEGREE_HIGHER] = sourceByteStride;
+
+                sourceByteStride += 1u * sizeof(float);
+
+                rests++;
+            }
+            else if (checkName.starts_with("f_rest_"))
+            {
+                // Higher degrees are differently stored in PLY, so the general offset it sufficient.
+
+                sourceByteStride += 1u * sizeof(float);
+
+                rests++;
+            }
+            else
+            {
+                // Note: Assuming, that PLY file is correctly packed e.g. x then y then z and sorted e.g. 0 then 1 and so on. Swizzling the rotation does not affect this and happens later.
+                continue;
+            }
+        }
+    }
+
+    if (!isPly || !isBinaryLittleEndian || !count || !sourceByteOffsets.contains(Attributes::POSITION) || !sourceByteOffsets.contains(Attributes::SCALE) || !sourceByteOffsets.contains(Attributes::OPACITY) || !sourceByteOffsets.contains(Attributes::ROTATION) || !sourceByteOffsets.contains(Attributes::SH_DEGREE_0_COEF_0))
+    {
+        return false;
+    }
+
+    // Depending on rests entries in the PLY file, deduct the degree.
+    std::uint32_t l{0u};
+    if (rests == 0u)
+    {
+        // Nothing for now
+    }
+    else if (rests == 3u * 3u)
+    {
+        l = 1u;
+    }
+    else if (rests == 3u * 3u + 5u * 3u)
+    {
+        l = 2u;
+    }
+    else if (rests == 3u * 3u + 5u * 3u + 7u * 3u)
+    {
+        l = 3u;
+    }
+    else
+    {
+        printf("Error: Unsupported amount of rest entries\n");
+
+        return false;
+    }
+
+    header.count = count;
+    header.degree = l;
+    header.sourceByteStride = sourceByteStride;
+    header.sourceByteOffsets = sourceByteOffsets;
+
+    return true;
+}
+
+bool convertPly(const char* binaryPly, std::uint32_t count, const PlyHeader& header, bool convert, char* binary)
+{
+    const std::uint32_t l{header.degree};
+    const std::uint32_t byteStride = getByteStride(l);
+    const std::uint32_t sourceByteStride{header.sourceByteStride};
+
+    // Looked up once, as copying or indexing the map per vertex is allocating.
+    std::uint32_t sourceByteOffsets[SH_DEGREE_HIGHER + 1]{};
+    for (const auto& [attribute, sourceByteOffset] : header.sourceByteOffsets)
+    {
+        sourceByteOffsets[attribute] = sourceByteOffset;
+    }
+
+    // Loop through vertices and by our given order how we store the attributes.
+    for (std::size_t vertex = 0u; vertex < count; vertex++)
+    {
+        std::uint32_t byteOffset{0u};
+
+        {
+            // POSITION
+            const float* sourceData = reinterpret_cast<const float*>(binaryPly + sourceByteStride * vertex + sourceByteOffsets[POSITION]);
+            float* data = reinterpret_cast<float*>(binary + byteStride * vertex + byteOffset);
+
+            float x{sourceData[0u]}; 
+            float y{sourceData[1u]}; 
+            float z{sourceData[2u]}; 
+
+            if (convert)
+            {
+                // Convert from right-handed z-up to right-handed y-up coordinate system. -90 degree rotation results in this swizzle.
+                data[0u] = x;
+                data[1u] = z;
+                data[2u] = -y;
+            }
+            else
+            {
+                data[0u] = x;
+                data[1u] = y;
+                data[2u] = z;
+            }
+
+            byteOffset += 3u * sizeof(float);
+        }
+
+        {
+            // ROTATION
+            const float* sourceData = reinterpret_cast<const float*>(binaryPly + sourceByteStride * vertex + sourceByteOffsets[ROTATION]);
+            float* data = reinterpret_cast<float*>(binary + byteStride * vertex + byteOffset);
+
+            // Need to swizzle the quaternion data because of layout.
+            float w{sourceData[0u]}; 
+            float x{sourceData[1u]}; 
+            float y{sourceData[2u]}; 
+            float z{sourceData[3u]}; 
+
+            // Also normalize it, as not given by PLY.
+            float norm = std::sqrt(x*x + y*y + z*z + w*w);
+            if (norm == 0.0f)
+            {
+                printf("Error: Invalid quaternion\n");
+
+                return false;
+            }
+
+            x = x / norm;
+            y = y / norm;
+            z = z / norm;
+            w = w / norm;
+
+            if (convert)
+            {
+                // Rotate -90 degree around x-axis, to convert from right-handed z-up to right-handed y-up coordinate system.
+                auto rotated = multiplyQuaternions({-0.7071, 0.0, 0.0, 0.7071}, {x, y, z, w});
+
+                data[0u] = rotated[0];
+                data[1u] = rotated[1];
+                data[2u] = rotated[2];
+                data[3u] = rotated[3];
+            }
+            else
+            {
+                data[0u] = x;
+                data[1u] = y;
+                data[2u] = z;
+                data[3u] = w;
+            }
+
+            byteOffset += 4u * sizeof(float);
+        }
+
+        {
+            // SCALE
+            const float* sourceData = reinterpret_cast<const float*>(binaryPly + sourceByteStride * vertex + sourceByteOffsets[SCALE]);
+            float* data = reinterpret_cast<float*>(binary + byteStride * vertex + byteOffset);
+
+            float x{sourceData[0u]}; 
+            float y{sourceData[1u]}; 
+            float z{sourceData[2u]}; 
+
+            // No rotation required, as scale impacted by rotation.
+            // Log to linear conversion.
+            data[0u] = std::exp(x);
+            data[1u] = std::exp(y);
+            data[2u] = std::exp(z);
+
+            byteOffset += 3u * sizeof(float);
+        }
+
+        {
+            // OPACITY
+            const float* sourceData = reinterpret_cast<const float*>(binaryPly + sourceByteStride * vertex + sourceByteOffsets[OPACITY]);
+            float* data = reinterpret_cast<float*>(binary + byteStride * vertex + byteOffset);
+
+            // Sigmoid function needs to be applied before storing.
+            const float opacity = *sourceData;
+            *data = 1.0f / (1.0f + std::exp(-opacity));
+
+            byteOffset += 1u * sizeof(float);
+        }
+
+        {
+            // SH_DEGREE_0_COEF_0
+            const float* sourceData = reinterpret_cast<const float*>(binaryPly + sourceByteStride * vertex + sourceByteOffsets[SH_DEGREE_0_COEF_0]);
+            float* data = reinterpret_cast<float*>(binary + byteStride * vertex + byteOffset);
+
+            // No rotation required, as identity.
+            data[0u] = sourceData[0u];
+            data[1u] = sourceData[1u];
+            data[2u] = sourceData[2u];
+
+            byteOffset += 3u * sizeof(float);
+        }
+
+        // Resolve for higher degrees.
+        {
+            // Offset at beginning to all bands.
+            const float* sourceData = reinterpret_cast<const float*>(binaryPly + sourceByteStride * vertex + sourceByteOffsets[SH_DEGREE_HIGHER]);
+
+            // Offset between coefficient sets depending on degree.
+            std::uint32_t sh_offset{0u};
+            if (l == 1u)
+            {
+                sh_offset = 3u;
+            }
+            else if (l == 2u)
+            {
+                sh_offset = 3u + 5u;
+            }
+            else if (l == 3u)
+            {
+                sh_offset = 3u + 5u + 7u;
+            }
+
+            // Fixed size, so the hot loop does not allocate.
+            float r[maxCoefficients];
+            float g[maxCoefficients];
+            float b[maxCoefficients];
+
+            if (convert)
+            {
+                // Rotate the spherical harmonics as well by -90 degrees around x-axis with optimized Wigner d-Matrix.
+                rotateSH_XAxisNeg90(&sourceData[0u * sh_offset], l, r);
+                rotateSH_XAxisNeg90(&sourceData[1u * sh_offset], l, g);
+                rotateSH_XAxisNeg90(&sourceData[2u * sh_offset], l, b);
+            }
+            else
+            {
+                gather(&sourceData[0u * sh_offset], l, r);
+                gather(&sourceData[1u * sh_offset], l, g);
+                gather(&sourceData[2u * sh_offset], l, b);
+            }
+
+            std::uint32_t band_offset{0u};
+            for (std::uint32_t current_l = 1u; current_l <= l; current_l++)
+            {
+                for (std::uint32_t current_n = 0u; current_n < 1u + 2u * current_l; current_n++)
+                {
+                    float* data = reinterpret_cast<float*>(binary + byteStride * vertex + byteOffset);
+
+                    data[0u] = r[band_offset + current_n];
+                    data[1u] = g[band_offset + current_n];
+                    data[2u] = b[band_offset + current_n];
+
+                    byteOffset += 3u * sizeof(float);
+                }
+
+                band_offset += 1u + 2u * current_l; 
+            }
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,37 @@
+#ifndef GLTF_PLY_H
+#define GLTF_PLY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+// Stores the related offset in the PLY file. Higher degrees are sorted by channel in PLY file, so this needs to be resolved differently for glTF.
+enum Attributes {
+    POSITION,
+    ROTATION,
+    SCALE,
+    OPACITY,
+    SH_DEGREE_0_COEF_0,
+    SH_DEGREE_HIGHER,
+};
+
+struct PlyHeader
+{
+    std::uint32_t count{0u};
+    std::uint32_t degree{0u};
+
+    std::uint32_t sourceByteStride{0u};
+    std::map<Attributes, std::uint32_t> sourceByteOffsets{};
+
+    // Size of the header including the end_header line, where the binary data starts.
+    std::size_t byteLength{0u};
+};
+
+// Parses the header at the beginning of the given PLY data. Returns false, if the data is not a supported 3DGS PLY.
+bool parsePlyHeader(const std::string& ply, PlyHeader& header);
+
+// Converts count PLY vertices in binaryPly to the interleaved glTF records in binary.
+bool convertPly(const char* binaryPly, std::uint32_t count, const PlyHeader& header, bool convert, char* binary);
+
+#endif /*GLTF_PLY_H*/
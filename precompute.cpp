@@ -0,0 +1,154 @@
+#include "precompute.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+
+#include "parallel.h"
+
+using json = nlohmann::json;
+
+// Two VEC3 float covariance accessors followed by the VEC4 unsigned byte color.
+constexpr std::uint32_t precomputedByteStride{6u * sizeof(float) + 4u};
+
+constexpr float shC0{0.28209479177387814f};
+
+static std::uint8_t toUnsignedByte(float value)
+{
+    return static_cast<std::uint8_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+}
+
+// Covariance R * S * S * R^T of the normalized quaternion x, y, z, w and the linear scale.
+static void getCovariance(const float* rotation, const float* scale, float* covariance)
+{
+    const float x{rotation[0u]};
+    const float y{rotation[1u]};
+    const float z{rotation[2u]};
+    const float w{rotation[3u]};
+
+    const float r[3][3]{
+        {1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y - w * z), 2.0f * (x * z + w * y)},
+        {2.0f * (x * y + w * z), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z - w * x)},
+        {2.0f * (x * z - w * y), 2.0f * (y * z + w * x), 1.0f - 2.0f * (x * x + y * y)},
+    };
+
+    float m[3][3];
+    for (std::uint32_t row = 0u; row < 3u; row++)
+    {
+        for (std::uint32_t column = 0u; column < 3u; column++)
+        {
+            m[row][column] = r[row][column] * scale[column];
+        }
+    }
+
+    std::uint32_t index{0u};
+    for (std::uint32_t row = 0u; row < 3u; row++)
+    {
+        for (std::uint32_t column = row; column < 3u; column++)
+        {
+            covariance[index++] = m[row][0u] * m[column][0u] + m[row][1u] * m[column][1u] + m[row][2u] * m[column][2u];
+        }
+    }
+}
+
+static std::size_t getAttributeByteOffset(const json& glTF, const json& primitive, const char* attribute)
+{
+    const json& accessor = glTF["accessors"][primitive["attributes"][attribute].get<std::size_t>()];
+
+    return accessor.value("byteOffset", std::size_t{0u});
+}
+
+void addPrecomputedAttributes(json& glTF, std::string& binary)
+{
+    // Precomputed bufferView per bufferView of the splats, shared e.g. by progressive levels.
+    std::map<std::size_t, std::size_t> precomputedBufferViews{};
+
+    for (json& mesh : glTF["meshes"])
+    {
+        for (json& primitive : mesh["primitives"])
+        {
+            if (!primitive["attributes"].contains("KHR_gaussian_splatting:ROTATION"))
+            {
+                continue;
+            }
+
+            const json& rotationAccessor = glTF["accessors"][primitive["attributes"]["KHR_gaussian_splatting:ROTATION"].get<std::size_t>()];
+            const std::size_t bufferViewIndex = rotationAccessor["bufferView"].get<std::size_t>();
+            const std::size_t count = rotationAccessor["count"].get<std::size_t>();
+
+            if (!precomputedBufferViews.contains(bufferViewIndex))
+            {
+                const json& bufferView = glTF["bufferViews"][bufferViewIndex];
+
+                const std::size_t byteOffset = bufferView.value("byteOffset", std::size_t{0u});
+                const std::size_t byteStride = bufferView["byteStride"].get<std::size_t>();
+                const std::size_t records = bufferView["byteLength"].get<std::size_t>() / byteStride;
+
+                const std::size_t rotationByteOffset = byteOffset + getAttributeByteOffset(glTF, primitive, "KHR_gaussian_splatting:ROTATION");
+                const std::size_t scaleByteOffset = byteOffset + getAttributeByteOffset(glTF, primitive, "KHR_gaussian_splatting:SCALE");
+                const std::size_t opacityByteOffset = byteOffset + getAttributeByteOffset(glTF, primitive, "KHR_gaussian_splatting:OPACITY");
+                const std::size_t colorByteOffset = byteOffset + getAttributeByteOffset(glTF, primitive, "KHR_gaussian_splatting:SH_DEGREE_0_COEF_0");
+
+                const std::size_t precomputedByteOffset{binary.size()};
+                binary.resize(precomputedByteOffset + precomputedByteStride * records);
+
+                parallelFor(0u, records, [&](std::size_t begin, std::size_t end) {
+                    for (std::size_t vertex = begin; vertex < end; vertex++)
+                    {
+                        const float* rotation = reinterpret_cast<const float*>(binary.data() + rotationByteOffset + byteStride * vertex);
+                        const float* scale = reinterpret_cast<const float*>(binary.data() + scaleByteOffset + byteStride * vertex);
+                        const float opacity = *reinterpret_cast<const float*>(binary.data() + opacityByteOffset + byteStride * vertex);
+                        const float* color = reinterpret_cast<const float*>(binary.data() + colorByteOffset + byteStride * vertex);
+
+                        char* data = binary.data() + precomputedByteOffset + precomputedByteStride * vertex;
+
+                        getCovariance(rotation, scale, reinterpret_cast<float*>(data));
+
+                        // Degree 0 is already in the display color space of KHR_gaussian_splatting.
+                        std::uint8_t* rgba = reinterpret_cast<std::uint8_t*>(data + 6u * sizeof(float));
+                        for (std::uint32_t i = 0u; i < 3u; i++)
+                        {
+                            rgba[i] = toUnsignedByte(0.5f + shC0 * color[i]);
+                        }
+                        rgba[3u] = toUnsignedByte(opacity);
+                    }
+                });
+
+                json precomputedBufferView = json::object();
+                precomputedBufferView["buffer"] = 0;
+                precomputedBufferView["byteOffset"] = precomputedByteOffset;
+                precomputedBufferView["byteLength"] = precomputedByteStride * records;
+                precomputedBufferView["byteStride"] = precomputedByteStride;
+                precomputedBufferView["target"] = 34962;
+
+                precomputedBufferViews[bufferViewIndex] = glTF["bufferViews"].size();
+                glTF["bufferViews"].push_back(precomputedBufferView);
+            }
+
+            const char* names[3u]{"_COVARIANCE_0", "_COVARIANCE_1", "COLOR_0"};
+            const char* types[3u]{"VEC3", "VEC3", "VEC4"};
+            const std::uint32_t componentTypes[3u]{5126u, 5126u, 5121u};
+            const std::uint32_t byteOffsets[3u]{0u, 3u * sizeof(float), 6u * sizeof(float)};
+
+            for (std::uint32_t i = 0u; i < 3u; i++)
+            {
+                json accessor = json::object();
+                accessor["bufferView"] = precomputedBufferViews[bufferViewIndex];
+                accessor["byteOffset"] = byteOffsets[i];
+                accessor["componentType"] = componentTypes[i];
+                if (componentTypes[i] == 5121u)
+                {
+                    accessor["normalized"] = true;
+                }
+                accessor["count"] = count;
+                accessor["type"] = types[i];
+
+                primitive["attributes"][names[i]] = glTF["accessors"].size();
+                glTF["accessors"].push_back(accessor);
+            }
+        }
+    }
+
+    glTF["buffers"][0]["byteLength"] = binary.size();
+}
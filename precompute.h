@@ -0,0 +1,13 @@
+#ifndef GLTF_PRECOMPUTE_H
+#define GLTF_PRECOMPUTE_H
+
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+// Appends the render ready attributes of every KHR_gaussian_splatting primitive to binary, so viewers can skip computing them
+// at load time: the upper triangle of the 3D covariance as _COVARIANCE_0 (xx, xy, xz) and _COVARIANCE_1 (yy, yz, zz), and the
+// sRGB base color with the opacity as normalized unsigned byte COLOR_0. Primitives sharing a bufferView share the attributes.
+void addPrecomputedAttributes(nlohmann::json& glTF, std::string& binary);
+
+#endif /*GLTF_PRECOMPUTE_H*/
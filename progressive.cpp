@@ -0,0 +1,125 @@
+#include "progressive.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "gltf.h"
+#include "parallel.h"
+
+using json = nlohmann::json;
+
+// Byte offsets in the interleaved record.
+constexpr std::uint32_t scaleByteOffset{(3u + 4u) * sizeof(float)};
+constexpr std::uint32_t opacityByteOffset{(3u + 4u + 3u) * sizeof(float)};
+
+// Levels are not generated below this amount of splats.
+constexpr std::uint32_t minimalLevelCount{256u};
+
+struct Importance
+{
+    float value{0.0f};
+    std::uint32_t index{0u};
+};
+
+void sortByImportance(std::string& binary, std::uint32_t count, std::uint32_t degree)
+{
+    const std::uint32_t byteStride = getByteStride(degree);
+
+    std::vector<Importance> importances(count);
+
+    parallelFor(0u, count, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t vertex = begin; vertex < end; vertex++)
+        {
+            const float* scale = reinterpret_cast<const float*>(binary.data() + byteStride * vertex + scaleByteOffset);
+            const float opacity = *reinterpret_cast<const float*>(binary.data() + byteStride * vertex + opacityByteOffset);
+
+            // Largest area of the ellipsoid seen from any direction.
+            const float smallest = std::min({scale[0u], scale[1u], scale[2u]});
+            const float area = smallest > 0.0f ? scale[0u] * scale[1u] * scale[2u] / smallest : 0.0f;
+
+            importances[vertex] = Importance{opacity * area, static_cast<std::uint32_t>(vertex)};
+        }
+    });
+
+    // Index as tie breaker, so the order does not depend on the thread count.
+    parallelSort(importances, [](const Importance& a, const Importance& b) {
+        return a.value > b.value || (a.value == b.value && a.index < b.index);
+    });
+
+    std::string sorted(binary.size(), '\0');
+
+    parallelFor(0u, count, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t vertex = begin; vertex < end; vertex++)
+        {
+            std::memcpy(sorted.data() + byteStride * vertex, binary.data() + static_cast<std::size_t>(byteStride) * importances[vertex].index, byteStride);
+        }
+    });
+
+    binary.swap(sorted);
+}
+
+void addProgressiveLevels(json& glTF, const std::string& binary, std::uint32_t count, std::uint32_t levels)
+{
+    const json primitive = glTF["meshes"][0u]["primitives"][0u];
+    const std::size_t byteStride = glTF["bufferViews"][0u]["byteStride"].get<std::size_t>();
+
+    json ids = json::array();
+
+    std::uint32_t levelCount{count};
+    for (std::uint32_t level = 1u; level <= levels; level++)
+    {
+        levelCount /= 4u;
+        if (levelCount < minimalLevelCount)
+        {
+            break;
+        }
+
+        printf("Info: Progressive level %u with the first %u splats\n", level, levelCount);
+
+        // Same accessors restricted to the prefix.
+        json prefix = primitive;
+        for (auto& attribute : prefix["attributes"])
+        {
+            json accessor = glTF["accessors"][attribute.get<std::size_t>()];
+            accessor["count"] = levelCount;
+
+            if (accessor.contains("min"))
+            {
+                float minPosition[3];
+                float maxPosition[3];
+                getPositionBounds(binary, levelCount, static_cast<std::uint32_t>(byteStride), minPosition, maxPosition);
+
+                accessor["min"] = {minPosition[0u], minPosition[1u], minPosition[2u]};
+                accessor["max"] = {maxPosition[0u], maxPosition[1u], maxPosition[2u]};
+            }
+
+            attribute = glTF["accessors"].size();
+            glTF["accessors"].push_back(accessor);
+        }
+
+        json mesh = json::object();
+        mesh["primitives"] = json::array();
+        mesh["primitives"].push_back(prefix);
+
+        json node = json::object();
+        node["mesh"] = glTF["meshes"].size();
+
+        glTF["meshes"].push_back(mesh);
+
+        ids.push_back(glTF["nodes"].size());
+        glTF["nodes"].push_back(node);
+    }
+
+    if (ids.empty())
+    {
+        return;
+    }
+
+    glTF["extensionsUsed"].push_back("MSFT_lod");
+
+    glTF["nodes"][0u]["extensions"] = json::object();
+    glTF["nodes"][0u]["extensions"]["MSFT_lod"] = json::object();
+    glTF["nodes"][0u]["extensions"]["MSFT_lod"]["ids"] = ids;
+}
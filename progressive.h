@@ -0,0 +1,17 @@
+#ifndef GLTF_PROGRESSIVE_H
+#define GLTF_PROGRESSIVE_H
+
+#include <cstdint>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+// Reorders the interleaved records by descending importance, the opacity times the projected area of the two largest
+// scale axes. Any prefix of the buffer then holds the most visible splats, so a partially fetched buffer is already renderable.
+void sortByImportance(std::string& binary, std::uint32_t count, std::uint32_t degree);
+
+// Adds up to the given amount of meshes covering prefixes of the sorted splats of the first mesh, each with about a quarter of the
+// splats of the previous one. They share the bufferView and are referenced by the first node using MSFT_lod.
+void addProgressiveLevels(nlohmann::json& glTF, const std::string& binary, std::uint32_t count, std::uint32_t levels);
+
+#endif /*GLTF_PROGRESSIVE_H*/
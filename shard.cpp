@@ -0,0 +1,331 @@
+#include "shard.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "gltf.h"
+#include "input.h"
+#include "io.h"
+#include "parallel.h"
+#include "ply.h"
+
+using json = nlohmann::json;
+
+// Bytes copied at once while concatenating the shards.
+constexpr std::size_t copySize{4u * 1024u * 1024u};
+
+struct Shard
+{
+    std::uint64_t first{0u};
+    std::uint32_t count{0u};
+    float minPosition[3]{};
+    float maxPosition[3]{};
+};
+
+static std::string getShardName(const std::string& stem, std::uint32_t shard, std::uint32_t shards)
+{
+    return stem + ".shard-" + std::to_string(shard) + "-of-" + std::to_string(shards);
+}
+
+bool convertShard(const std::string& filename, std::uint32_t shard, std::uint32_t shards, bool convert, const std::string& outputDirectory, const std::string& stem, std::string& input, std::string& binary)
+{
+    PlyHeader header{};
+    if (!readInputHeader(filename, InputFormat::PLY, header))
+    {
+        printf("Error: Can not process `%s` file\n", filename.c_str());
+
+        return false;
+    }
+
+    const std::uint64_t first = static_cast<std::uint64_t>(header.count) * shard / shards;
+    const std::uint32_t count = static_cast<std::uint32_t>(static_cast<std::uint64_t>(header.count) * (shard + 1u) / shards - first);
+
+    printf("Info: Converting shard %u of %u with splats %llu to %llu\n", shard, shards, static_cast<unsigned long long>(first), static_cast<unsigned long long>(first + count));
+
+    // Only the byte range of the shard is read.
+    std::ifstream file(filename, std::ios::binary);
+    file.seekg(static_cast<std::streamoff>(header.byteLength + first * header.sourceByteStride));
+
+    input.resize(static_cast<std::size_t>(header.sourceByteStride) * count);
+    file.read(input.data(), static_cast<std::streamsize>(input.size()));
+    if (static_cast<std::size_t>(file.gcount()) != input.size())
+    {
+        printf("Error: `%s` file is truncated\n", filename.c_str());
+
+        return false;
+    }
+
+    binary.resize(static_cast<std::size_t>(getByteStride(header.degree)) * count);
+
+    if (!convertPly(input.data(), count, header, convert, binary.data()))
+    {
+        return false;
+    }
+
+    Shard result{first, count};
+    getPositionBounds(binary, count, getByteStride(header.degree), result.minPosition, result.maxPosition);
+
+    json manifest = json::object();
+    manifest["shard"] = shard;
+    manifest["shards"] = shards;
+    manifest["first"] = result.first;
+    manifest["count"] = result.count;
+    manifest["total"] = header.count;
+    manifest["degree"] = header.degree;
+    manifest["min"] = std::vector<float>(result.minPosition, result.minPosition + 3u);
+    manifest["max"] = std::vector<float>(result.maxPosition, result.maxPosition + 3u);
+
+    const std::filesystem::path savename{std::filesystem::path(outputDirectory) / getShardName(stem, shard, shards)};
+
+    // The manifest is saved last, so it only exists for complete shards.
+    if (!saveFile(binary, savename.generic_string() + ".bin") || !saveFile(manifest.dump(3), savename.generic_string() + ".json"))
+    {
+        printf("Error: Could not save '%s'\n", savename.generic_string().c_str());
+
+        return false;
+    }
+
+    printf("Info: Saved '%s'\n", (savename.generic_string() + ".bin").c_str());
+
+    return true;
+}
+
+// Appends the shard file at byteOffset of the already sized output file.
+static bool copyShard(const std::string& shardname, const std::string& savename, std::size_t byteOffset)
+{
+    std::ifstream input(shardname, std::ios::binary);
+    std::fstream output(savename, std::ios::binary | std::ios::in | std::ios::out);
+    if (!input.is_open() || !output.is_open())
+    {
+        return false;
+    }
+
+    output.seekp(static_cast<std::streamoff>(byteOffset));
+
+    std::vector<char> data(copySize);
+    while (input)
+    {
+        input.read(data.data(), static_cast<std::streamsize>(data.size()));
+        if (input.gcount() > 0)
+        {
+            output.write(data.data(), input.gcount());
+        }
+    }
+
+    return static_cast<bool>(output);
+}
+
+bool mergeShards(std::uint32_t shards, std::size_t maxBufferSize, const std::string& outputDirectory, const std::string& stem)
+{
+    //
+    // Reading and validating the manifests.
+    //
+
+    std::vector<Shard> parts(shards);
+    std::uint32_t degree{0u};
+    std::uint64_t total{0u};
+
+    for (std::uint32_t shard = 0u; shard < shards; shard++)
+    {
+        const std::string loadname{(std::filesystem::path(outputDirectory) / getShardName(stem, shard, shards)).generic_string() + ".json"};
+
+        json manifest = json::parse(loadFile(loadname), nullptr, false);
+        if (manifest.is_discarded() || !manifest.is_object())
+        {
+            printf("Error: Could not load '%s', has shard %u been converted?\n", loadname.c_str(), shard);
+
+            return false;
+        }
+
+        Shard& part = parts[shard];
+
+        try
+        {
+            part.first = manifest["first"].get<std::uint64_t>();
+            part.count = manifest["count"].get<std::uint32_t>();
+            for (std::uint32_t i = 0u; i < 3u; i++)
+            {
+                part.minPosition[i] = manifest["min"][i].get<float>();
+                part.maxPosition[i] = manifest["max"][i].get<float>();
+            }
+
+            if (shard == 0u)
+            {
+                degree = manifest["degree"].get<std::uint32_t>();
+                total = manifest["total"].get<std::uint64_t>();
+            }
+
+            // Shards have to be of the same input and follow each other.
+            const std::uint64_t expected = shard == 0u ? 0u : parts[shard - 1u].first + parts[shard - 1u].count;
+            if (manifest["shards"].get<std::uint32_t>() != shards || manifest["degree"].get<std::uint32_t>() != degree || manifest["total"].get<std::uint64_t>() != total || part.first != expected)
+            {
+                printf("Error: Shard %u does not belong to the other shards\n", shard);
+
+                return false;
+            }
+        }
+        catch (const json::exception&)
+        {
+            printf("Error: Invalid manifest '%s'\n", loadname.c_str());
+
+            return false;
+        }
+    }
+
+    if (parts.back().first + parts.back().count != total)
+    {
+        printf("Error: Shards do not cover all %llu splats\n", static_cast<unsigned long long>(total));
+
+        return false;
+    }
+
+    //
+    // Grouping consecutive shards into buffers.
+    //
+
+    const std::size_t byteStride = getByteStride(degree);
+
+    struct Group
+    {
+        std::uint32_t begin{0u};
+        std::uint32_t end{0u};
+        std::size_t byteLength{0u};
+    };
+
+    std::vector<Group> groups{};
+    for (std::uint32_t shard = 0u; shard < shards; shard++)
+    {
+        const std::size_t byteLength = byteStride * parts[shard].count;
+        if (byteLength > maxBufferSize)
+        {
+            printf("Error: Shard %u exceeds --max-buffer-size, more shards are required\n", shard);
+
+            return false;
+        }
+
+        if (groups.empty() || groups.back().byteLength + byteLength > maxBufferSize)
+        {
+            groups.push_back(Group{shard, shard, 0u});
+        }
+
+        groups.back().end = shard + 1u;
+        groups.back().byteLength += byteLength;
+    }
+
+    //
+    // Concatenating the shards.
+    //
+
+    const std::string uri{stem + ".bin"};
+
+    for (std::size_t g = 0u; g < groups.size(); g++)
+    {
+        const std::string savename{(std::filesystem::path(outputDirectory) / getBufferUri(uri, g)).generic_string()};
+
+        // Sized up front, so every shard can be written at its offset.
+        std::error_code error{};
+        std::ofstream(savename, std::ios::binary | std::ios::trunc).close();
+        std::filesystem::resize_file(savename, groups[g].byteLength, error);
+        if (error)
+        {
+            printf("Error: Could not save '%s'\n", savename.c_str());
+
+            return false;
+        }
+    }
+
+    std::atomic<bool> failed{false};
+
+    parallelFor(0u, shards, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t shard = begin; shard < end; shard++)
+        {
+            const auto group = std::find_if(groups.begin(), groups.end(), [&](const Group& candidate) {
+                return shard < candidate.end;
+            });
+
+            std::size_t byteOffset{0u};
+            for (std::uint32_t previous = group->begin; previous < shard; previous++)
+            {
+                byteOffset += byteStride * parts[previous].count;
+            }
+
+            const std::string shardname{(std::filesystem::path(outputDirectory) / getShardName(stem, static_cast<std::uint32_t>(shard), shards)).generic_string() + ".bin"};
+            const std::string savename{(std::filesystem::path(outputDirectory) / getBufferUri(uri, static_cast<std::size_t>(group - groups.begin()))).generic_string()};
+
+            std::error_code error{};
+            if (std::filesystem::file_size(shardname, error) != byteStride * parts[shard].count || error || !copyShard(shardname, savename, byteOffset))
+            {
+                printf("Error: Could not copy '%s'\n", shardname.c_str());
+
+                failed = true;
+            }
+        }
+    });
+
+    if (failed)
+    {
+        return false;
+    }
+
+    //
+    // glTF with one primitive per buffer and the bounds combined from its shards.
+    //
+
+    json glTF{};
+
+    for (std::size_t g = 0u; g < groups.size(); g++)
+    {
+        std::uint32_t count{0u};
+        float minPosition[3]{parts[groups[g].begin].minPosition[0u], parts[groups[g].begin].minPosition[1u], parts[groups[g].begin].minPosition[2u]};
+        float maxPosition[3]{parts[groups[g].begin].maxPosition[0u], parts[groups[g].begin].maxPosition[1u], parts[groups[g].begin].maxPosition[2u]};
+
+        for (std::uint32_t shard = groups[g].begin; shard < groups[g].end; shard++)
+        {
+            count += parts[shard].count;
+
+            for (std::uint32_t i = 0u; i < 3u; i++)
+            {
+                minPosition[i] = std::min(minPosition[i], parts[shard].minPosition[i]);
+                maxPosition[i] = std::max(maxPosition[i], parts[shard].maxPosition[i]);
+            }
+        }
+
+        if (g == 0u)
+        {
+            glTF = createGltf(uri, groups[g].byteLength, count, degree, minPosition, maxPosition);
+
+            continue;
+        }
+
+        json buffer = json::object();
+        buffer["uri"] = getBufferUri(uri, g);
+        buffer["byteLength"] = groups[g].byteLength;
+        glTF["buffers"].push_back(buffer);
+
+        // Added as further primitive of the first mesh, like splitting a buffer.
+        const std::uint32_t meshIndex = addMesh(glTF, 0u, groups[g].byteLength, count, degree, minPosition, maxPosition);
+        glTF["bufferViews"].back()["buffer"] = g;
+
+        glTF["meshes"][0]["primitives"].push_back(glTF["meshes"][meshIndex]["primitives"][0]);
+        glTF["meshes"].erase(meshIndex);
+    }
+
+    const std::string savenameJson{(std::filesystem::path(outputDirectory) / (stem + ".gltf")).generic_string()};
+    if (!saveFile(glTF.dump(3), savenameJson))
+    {
+        printf("Error: Could not save '%s'\n", savenameJson.c_str());
+
+        return false;
+    }
+
+    printf("Info: Merged %u shards with %llu splats into %zu buffers of '%s'\n", shards, static_cast<unsigned long long>(total), groups.size(), savenameJson.c_str());
+
+    return true;
+}
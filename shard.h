@@ -0,0 +1,16 @@
+#ifndef GLTF_SHARD_H
+#define GLTF_SHARD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Converts only the given shard of the PLY vertices, split into shards ranges of about equal size, reading just its byte range.
+// Saves the interleaved records as 'stem.shard-i-of-n.bin' together with 'stem.shard-i-of-n.json' holding the range and bounds.
+bool convertShard(const std::string& filename, std::uint32_t shard, std::uint32_t shards, bool convert, const std::string& outputDirectory, const std::string& stem, std::string& input, std::string& binary);
+
+// Concatenates the records of all shards into buffers of at most maxBufferSize bytes, each a primitive with the combined bounds of
+// its shards, and saves the glTF. Shards are copied concurrently and not loaded into memory.
+bool mergeShards(std::uint32_t shards, std::size_t maxBufferSize, const std::string& outputDirectory, const std::string& stem);
+
+#endif /*GLTF_SHARD_H*/
@@ -0,0 +1,467 @@
+#include "texture.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <mutex>
+
+#if defined(PLY2GLTF_ZLIB)
+#include <zlib.h>
+#endif
+
+#include "gltf.h"
+#include "io.h"
+#include "parallel.h"
+
+using json = nlohmann::json;
+
+// Bits per axis of the Morton code.
+constexpr std::uint32_t mortonBits{21u};
+
+// Splats are laid out in blocks of blockSize x blockSize texels, each in Morton order. The blocks are filled row by row.
+constexpr std::uint32_t blockSize{16u};
+
+// Largest stored block of a deflate stream.
+constexpr std::size_t maxStoredBlockSize{65535u};
+
+struct MortonCode
+{
+    std::uint64_t code{0u};
+    std::uint32_t index{0u};
+};
+
+// Quantized attribute, stored at byteOffset in the interleaved record.
+struct TextureAttribute
+{
+    std::string name{};
+    std::uint32_t byteOffset{0u};
+    std::uint32_t components{0u};
+    std::uint32_t bits{8u};
+    // Quantizes the logarithm, which is more uniformly distributed e.g. for the scale.
+    bool logarithmic{false};
+};
+
+static std::uint64_t expandBits(std::uint64_t value)
+{
+    value &= 0x1fffffu;
+    value = (value | value << 32u) & 0x1f00000000ffffull;
+    value = (value | value << 16u) & 0x1f0000ff0000ffull;
+    value = (value | value << 8u) & 0x100f00f00f00f00full;
+    value = (value | value << 4u) & 0x10c30c30c30c30c3ull;
+    value = (value | value << 2u) & 0x1249249249249249ull;
+
+    return value;
+}
+
+// Every second bit of value, starting with the lowest one.
+static std::uint32_t compactBits(std::uint32_t value)
+{
+    value &= 0x55555555u;
+    value = (value | value >> 1u) & 0x33333333u;
+    value = (value | value >> 2u) & 0x0f0f0f0fu;
+    value = (value | value >> 4u) & 0x00ff00ffu;
+    value = (value | value >> 8u) & 0x0000ffffu;
+
+    return value;
+}
+
+void sortByMortonOrder(std::string& binary, std::uint32_t count, std::uint32_t degree)
+{
+    const std::uint32_t byteStride = getByteStride(degree);
+
+    float minPosition[3];
+    float maxPosition[3];
+    getPositionBounds(binary, count, byteStride, minPosition, maxPosition);
+
+    const float extent = std::max({maxPosition[0u] - minPosition[0u], maxPosition[1u] - minPosition[1u], maxPosition[2u] - minPosition[2u], std::numeric_limits<float>::min()});
+    const float cells = static_cast<float>((1u << mortonBits) - 1u);
+
+    std::vector<MortonCode> codes(count);
+
+    parallelFor(0u, count, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t vertex = begin; vertex < end; vertex++)
+        {
+            const float* position = reinterpret_cast<const float*>(binary.data() + byteStride * vertex);
+
+            std::uint64_t code{0u};
+            for (std::uint32_t i = 0u; i < 3u; i++)
+            {
+                const float cell = std::clamp((position[i] - minPosition[i]) / extent * cells, 0.0f, cells);
+
+                code |= expandBits(static_cast<std::uint64_t>(cell)) << i;
+            }
+
+            codes[vertex] = MortonCode{code, static_cast<std::uint32_t>(vertex)};
+        }
+    });
+
+    parallelSort(codes, [](const MortonCode& a, const MortonCode& b) {
+        return a.code < b.code || (a.code == b.code && a.index < b.index);
+    });
+
+    std::string sorted(binary.size(), '\0');
+
+    parallelFor(0u, count, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t vertex = begin; vertex < end; vertex++)
+        {
+            std::memcpy(sorted.data() + byteStride * vertex, binary.data() + static_cast<std::size_t>(byteStride) * codes[vertex].index, byteStride);
+        }
+    });
+
+    binary.swap(sorted);
+}
+
+//
+// PNG
+//
+
+static std::uint32_t getCrc32(const char* data, std::size_t size, std::uint32_t crc)
+{
+    static const std::array<std::uint32_t, 256u> table = [] {
+        std::array<std::uint32_t, 256u> values{};
+        for (std::uint32_t i = 0u; i < 256u; i++)
+        {
+            std::uint32_t value{i};
+            for (std::uint32_t bit = 0u; bit < 8u; bit++)
+            {
+                value = value & 1u ? 0xedb88320u ^ (value >> 1u) : value >> 1u;
+            }
+            values[i] = value;
+        }
+
+        return values;
+    }();
+
+    crc = ~crc;
+    for (std::size_t i = 0u; i < size; i++)
+    {
+        crc = table[(crc ^ static_cast<std::uint8_t>(data[i])) & 0xffu] ^ (crc >> 8u);
+    }
+
+    return ~crc;
+}
+
+static void appendBigEndian(std::string& output, std::uint32_t value)
+{
+    output += static_cast<char>(value >> 24u);
+    output += static_cast<char>(value >> 16u);
+    output += static_cast<char>(value >> 8u);
+    output += static_cast<char>(value);
+}
+
+static void appendChunk(std::string& png, const char* type, const std::string& data)
+{
+    appendBigEndian(png, static_cast<std::uint32_t>(data.size()));
+
+    const std::size_t typeOffset{png.size()};
+    png.append(type, 4u);
+    png += data;
+
+    appendBigEndian(png, getCrc32(png.data() + typeOffset, png.size() - typeOffset, 0u));
+}
+
+// zlib stream of the data, with stored blocks if zlib is not available.
+static bool deflateData(const std::string& data, std::string& output)
+{
+#if defined(PLY2GLTF_ZLIB)
+    uLongf outputSize = compressBound(static_cast<uLong>(data.size()));
+    output.resize(outputSize);
+
+    if (compress2(reinterpret_cast<Bytef*>(output.data()), &outputSize, reinterpret_cast<const Bytef*>(data.data()), static_cast<uLong>(data.size()), Z_DEFAULT_COMPRESSION) != Z_OK)
+    {
+        return false;
+    }
+
+    output.resize(outputSize);
+#else
+    // Deflate with a 32 KiB window and no compression.
+    output.assign("\x78\x01", 2u);
+
+    std::size_t offset{0u};
+    do
+    {
+        const std::size_t size = std::min(data.size() - offset, maxStoredBlockSize);
+
+        output += static_cast<char>(offset + size == data.size() ? 1u : 0u);
+        output += static_cast<char>(size);
+        output += static_cast<char>(size >> 8u);
+        output += static_cast<char>(~size);
+        output += static_cast<char>(~size >> 8u);
+        output.append(data, offset, size);
+
+        offset += size;
+    } while (offset < data.size());
+
+    std::uint32_t a{1u};
+    std::uint32_t b{0u};
+    for (const char value : data)
+    {
+        a = (a + static_cast<std::uint8_t>(value)) % 65521u;
+        b = (b + a) % 65521u;
+    }
+    appendBigEndian(output, (b << 16u) | a);
+#endif
+
+    return true;
+}
+
+// Encodes texels of the given channels with 8 or 16 bit big endian components.
+static bool encodePng(const std::string& image, std::uint32_t width, std::uint32_t height, std::uint32_t channels, std::uint32_t bits, std::string& png)
+{
+    const std::size_t texelSize = channels * bits / 8u;
+    const std::size_t rowSize = texelSize * width;
+
+    // Sub filter, as neighboring texels are similar.
+    std::string filtered(height * (rowSize + 1u), '\0');
+    for (std::size_t y = 0u; y < height; y++)
+    {
+        const char* row = image.data() + rowSize * y;
+        char* filteredRow = filtered.data() + (rowSize + 1u) * y;
+
+        filteredRow[0u] = 1;
+        for (std::size_t i = 0u; i < rowSize; i++)
+        {
+            filteredRow[1u + i] = static_cast<char>(row[i] - (i >= texelSize ? row[i - texelSize] : 0));
+        }
+    }
+
+    std::string compressed{};
+    if (!deflateData(filtered, compressed))
+    {
+        return false;
+    }
+
+    // Grayscale, RGB or RGBA.
+    const std::uint8_t colorTypes[5u]{0u, 0u, 0u, 2u, 6u};
+
+    std::string header{};
+    appendBigEndian(header, width);
+    appendBigEndian(header, height);
+    header += static_cast<char>(bits);
+    header += static_cast<char>(colorTypes[channels]);
+    // Compression, filter and interlace method.
+    header.append(3u, '\0');
+
+    png.assign("\x89PNG\r\n\x1a\n", 8u);
+    appendChunk(png, "IHDR", header);
+    appendChunk(png, "IDAT", compressed);
+    appendChunk(png, "IEND", std::string{});
+
+    return true;
+}
+
+//
+// Textures
+//
+
+static std::vector<TextureAttribute> getTextureAttributes(std::uint32_t degree)
+{
+    std::vector<TextureAttribute> attributes{
+        {"POSITION", 0u, 3u, 16u, false},
+        {"ROTATION", 3u * sizeof(float), 4u, 8u, false},
+        {"SCALE", (3u + 4u) * sizeof(float), 3u, 8u, true},
+        {"OPACITY", (3u + 4u + 3u) * sizeof(float), 1u, 8u, false},
+        {"SH_DEGREE_0_COEF_0", (3u + 4u + 3u + 1u) * sizeof(float), 3u, 8u, false},
+    };
+
+    std::uint32_t byteOffset{(3u + 4u + 3u + 1u + 3u) * sizeof(float)};
+    for (std::uint32_t current_l = 1u; current_l <= degree; current_l++)
+    {
+        for (std::uint32_t current_n = 0u; current_n < 1u + 2u * current_l; current_n++)
+        {
+            attributes.push_back({"SH_DEGREE_" + std::to_string(current_l) + "_COEF_" + std::to_string(current_n), byteOffset, 3u, 8u, false});
+
+            byteOffset += 3u * sizeof(float);
+        }
+    }
+
+    return attributes;
+}
+
+static float getValue(const TextureAttribute& attribute, const char* record, std::uint32_t component)
+{
+    const float value = reinterpret_cast<const float*>(record + attribute.byteOffset)[component];
+
+    return attribute.logarithmic ? std::log(std::max(value, std::numeric_limits<float>::min())) : value;
+}
+
+// Texel of the i-th splat.
+static void getTexel(std::size_t index, std::uint32_t width, std::size_t& x, std::size_t& y)
+{
+    const std::size_t block = index / (blockSize * blockSize);
+    const std::uint32_t texel = static_cast<std::uint32_t>(index % (blockSize * blockSize));
+    const std::size_t blocksPerRow = width / blockSize;
+
+    x = block % blocksPerRow * blockSize + compactBits(texel);
+    y = block / blocksPerRow * blockSize + compactBits(texel >> 1u);
+}
+
+bool saveTextures(json& glTF, const std::string& binary, std::uint32_t count, std::uint32_t degree, bool png, const std::string& outputDirectory, const std::string& stem, std::vector<std::string>& outputs)
+{
+    const std::uint32_t byteStride = getByteStride(degree);
+
+    // Power of two width of about the square root, so the textures are close to square.
+    std::uint32_t width{blockSize};
+    while (static_cast<std::uint64_t>(width) * width < count)
+    {
+        width *= 2u;
+    }
+
+    const std::size_t blocks = (static_cast<std::size_t>(count) + blockSize * blockSize - 1u) / (blockSize * blockSize);
+    const std::size_t blocksPerRow = width / blockSize;
+    const std::uint32_t height = static_cast<std::uint32_t>(std::max<std::size_t>((blocks + blocksPerRow - 1u) / blocksPerRow, 1u) * blockSize);
+
+    const std::vector<TextureAttribute> attributes = getTextureAttributes(degree);
+
+    std::vector<std::string> filenames(attributes.size());
+    std::vector<json> descriptions(attributes.size());
+    std::atomic<bool> failed{false};
+
+    // Attributes are quantized and encoded concurrently, as compressing a PNG is sequential.
+    parallelFor(0u, attributes.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t a = begin; a < end; a++)
+        {
+            const TextureAttribute& attribute = attributes[a];
+
+            float minimum[4]{};
+            float maximum[4]{};
+            for (std::uint32_t c = 0u; c < attribute.components; c++)
+            {
+                minimum[c] = std::numeric_limits<float>::max();
+                maximum[c] = std::numeric_limits<float>::lowest();
+            }
+
+            for (std::size_t vertex = 0u; vertex < count; vertex++)
+            {
+                for (std::uint32_t c = 0u; c < attribute.components; c++)
+                {
+                    const float value = getValue(attribute, binary.data() + byteStride * vertex, c);
+
+                    minimum[c] = std::min(minimum[c], value);
+                    maximum[c] = std::max(maximum[c], value);
+                }
+            }
+
+            const std::uint32_t componentSize{attribute.bits / 8u};
+            const std::size_t texelSize = attribute.components * componentSize;
+            const float levels = static_cast<float>((1u << attribute.bits) - 1u);
+
+            std::string image(texelSize * width * height, '\0');
+
+            for (std::size_t vertex = 0u; vertex < count; vertex++)
+            {
+                std::size_t x{0u};
+                std::size_t y{0u};
+                getTexel(vertex, width, x, y);
+
+                char* texel = image.data() + texelSize * (y * width + x);
+
+                for (std::uint32_t c = 0u; c < attribute.components; c++)
+                {
+                    const float range = maximum[c] - minimum[c];
+                    const float value = getValue(attribute, binary.data() + byteStride * vertex, c);
+                    const std::uint32_t quantized = range > 0.0f ? static_cast<std::uint32_t>(std::lround(std::clamp((value - minimum[c]) / range, 0.0f, 1.0f) * levels)) : 0u;
+
+                    // PNG is big endian, raw texels are little endian for uploading directly.
+                    for (std::uint32_t i = 0u; i < componentSize; i++)
+                    {
+                        const std::uint32_t shift = png ? 8u * (componentSize - 1u - i) : 8u * i;
+
+                        texel[c * componentSize + i] = static_cast<char>(quantized >> shift);
+                    }
+                }
+            }
+
+            std::string name{attribute.name};
+            std::transform(name.begin(), name.end(), name.begin(), [](char character) {
+                return static_cast<char>(std::tolower(static_cast<unsigned char>(character)));
+            });
+            filenames[a] = stem + "_" + name + (png ? ".png" : ".raw");
+
+            std::string output{};
+            if (png && !encodePng(image, width, height, attribute.components, attribute.bits, output))
+            {
+                printf("Error: Could not encode '%s'\n", filenames[a].c_str());
+
+                failed = true;
+
+                continue;
+            }
+
+            const std::string savename{(std::filesystem::path(outputDirectory) / filenames[a]).generic_string()};
+            if (!saveFile(png ? output : image, savename))
+            {
+                printf("Error: Could not save '%s'\n", savename.c_str());
+
+                failed = true;
+
+                continue;
+            }
+
+            json description = json::object();
+            description["bits"] = attribute.bits;
+            description["components"] = attribute.components;
+            if (attribute.logarithmic)
+            {
+                description["logarithmic"] = true;
+            }
+            description["min"] = std::vector<float>(minimum, minimum + attribute.components);
+            description["max"] = std::vector<float>(maximum, maximum + attribute.components);
+
+            descriptions[a] = description;
+        }
+    });
+
+    if (failed)
+    {
+        return false;
+    }
+
+    //
+    // Extension referencing the images or raw files.
+    //
+
+    json extension = json::object();
+    extension["width"] = width;
+    extension["height"] = height;
+    extension["blockSize"] = blockSize;
+    extension["attributes"] = json::object();
+
+    for (std::size_t a = 0u; a < attributes.size(); a++)
+    {
+        if (png)
+        {
+            if (!glTF.contains("images"))
+            {
+                glTF["images"] = json::array();
+            }
+
+            json image = json::object();
+            image["uri"] = filenames[a];
+
+            descriptions[a]["image"] = glTF["images"].size();
+            glTF["images"].push_back(image);
+        }
+        else
+        {
+            descriptions[a]["uri"] = filenames[a];
+        }
+
+        extension["attributes"][attributes[a].name] = descriptions[a];
+
+        outputs.push_back((std::filesystem::path(outputDirectory) / filenames[a]).generic_string());
+    }
+
+    glTF["meshes"][0]["primitives"][0]["extensions"]["EXT_gaussian_splatting_textures"] = extension;
+    glTF["extensionsUsed"].push_back("EXT_gaussian_splatting_textures");
+
+    printf("Info: Saved %zu textures of %ux%u texels\n", attributes.size(), width, height);
+
+    return true;
+}
@@ -0,0 +1,18 @@
+#ifndef GLTF_TEXTURE_H
+#define GLTF_TEXTURE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+// Reorders the interleaved records by the Morton code of their position, so neighboring texels hold nearby splats.
+void sortByMortonOrder(std::string& binary, std::uint32_t count, std::uint32_t degree);
+
+// Quantizes every attribute of the first mesh into its own texture, with splat i at the i-th texel of 16x16 blocks in Morton order,
+// and saves them as raw little endian texels or PNG images next to the glTF. The textures are described by the
+// EXT_gaussian_splatting_textures extension of the primitive. Saved files are added to outputs.
+bool saveTextures(nlohmann::json& glTF, const std::string& binary, std::uint32_t count, std::uint32_t degree, bool png, const std::string& outputDirectory, const std::string& stem, std::vector<std::string>& outputs);
+
+#endif /*GLTF_TEXTURE_H*/
@@ -0,0 +1,418 @@
+#include "tile.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <limits>
+
+#include <nlohmann/json.hpp>
+
+#include "gltf.h"
+#include "io.h"
+#include "lod.h"
+#include "parallel.h"
+
+using json = nlohmann::json;
+
+// Deepest octree level, which also stops subdividing splats sharing the same position.
+constexpr std::uint32_t maxDepth{21u};
+
+// Nodes with more splats are subdividing their children in parallel.
+constexpr std::uint32_t parallelSplats{65536u};
+
+// A Gaussian is covered by three times its scale.
+constexpr float splatExtent{3.0f};
+
+// Byte offset of SCALE in the interleaved record, after POSITION and ROTATION.
+constexpr std::uint32_t scaleByteOffset{(3u + 4u) * sizeof(float)};
+
+static void computeLeafBounds(TileNode& node, const Octree& octree, const std::string& binary, std::uint32_t byteStride)
+{
+    for (std::uint32_t i = 0u; i < 3u; i++)
+    {
+        node.minPosition[i] = std::numeric_limits<float>::max();
+        node.maxPosition[i] = std::numeric_limits<float>::lowest();
+        node.minBounds[i] = std::numeric_limits<float>::max();
+        node.maxBounds[i] = std::numeric_limits<float>::lowest();
+    }
+
+    for (std::uint32_t i = node.begin; i < node.end; i++)
+    {
+        const float* position = reinterpret_cast<const float*>(binary.data() + static_cast<std::size_t>(byteStride) * octree.indices[i]);
+        const float* scale = reinterpret_cast<const float*>(binary.data() + static_cast<std::size_t>(byteStride) * octree.indices[i] + scaleByteOffset);
+
+        const float extent = splatExtent * std::max(scale[0u], std::max(scale[1u], scale[2u]));
+
+        for (std::uint32_t j = 0u; j < 3u; j++)
+        {
+            node.minPosition[j] = std::min(node.minPosition[j], position[j]);
+            node.maxPosition[j] = std::max(node.maxPosition[j], position[j]);
+            node.minBounds[j] = std::min(node.minBounds[j], position[j] - extent);
+            node.maxBounds[j] = std::max(node.maxBounds[j], position[j] + extent);
+        }
+    }
+}
+
+static void subdivide(TileNode& node, const float cellMin[3], const float cellMax[3], Octree& octree, const std::string& binary, std::uint32_t byteStride, std::uint32_t maxSplats)
+{
+    const std::uint32_t size = node.end - node.begin;
+
+    if (size <= maxSplats || node.depth >= maxDepth)
+    {
+        computeLeafBounds(node, octree, binary, byteStride);
+
+        return;
+    }
+
+    float center[3];
+    for (std::uint32_t i = 0u; i < 3u; i++)
+    {
+        center[i] = 0.5f * (cellMin[i] + cellMax[i]);
+    }
+
+    // Counting sort of the node range by octant, so every child covers a contiguous range.
+    std::vector<std::uint8_t> octants(size);
+    std::uint32_t counts[8u]{};
+    for (std::uint32_t i = 0u; i < size; i++)
+    {
+        const float* position = reinterpret_cast<const float*>(binary.data() + static_cast<std::size_t>(byteStride) * octree.indices[node.begin + i]);
+
+        std::uint8_t octant{0u};
+        for (std::uint32_t j = 0u; j < 3u; j++)
+        {
+            if (position[j] >= center[j])
+            {
+                octant |= static_cast<std::uint8_t>(1u << j);
+            }
+        }
+
+        octants[i] = octant;
+        counts[octant]++;
+    }
+
+    std::uint32_t offsets[8u]{};
+    for (std::uint32_t octant = 1u; octant < 8u; octant++)
+    {
+        offsets[octant] = offsets[octant - 1u] + counts[octant - 1u];
+    }
+
+    std::vector<std::uint32_t> sorted(size);
+    {
+        std::uint32_t current[8u];
+        std::memcpy(current, offsets, sizeof(offsets));
+
+        for (std::uint32_t i = 0u; i < size; i++)
+        {
+            sorted[current[octants[i]]++] = octree.indices[node.begin + i];
+        }
+    }
+    std::copy(sorted.begin(), sorted.end(), octree.indices.begin() + node.begin);
+
+    // Children have to exist before subdividing them, as the vector must not grow anymore.
+    std::vector<std::uint8_t> childOctants{};
+    for (std::uint32_t octant = 0u; octant < 8u; octant++)
+    {
+        if (counts[octant] == 0u)
+        {
+            continue;
+        }
+
+        TileNode child{};
+        child.begin = node.begin + offsets[octant];
+        child.end = child.begin + counts[octant];
+        child.depth = node.depth + 1u;
+
+        node.children.push_back(child);
+        childOctants.push_back(static_cast<std::uint8_t>(octant));
+    }
+
+    auto subdivideChild = [&](std::size_t c) {
+        float childMin[3];
+        float childMax[3];
+        for (std::uint32_t j = 0u; j < 3u; j++)
+        {
+            const bool upper = (childOctants[c] & (1u << j)) != 0u;
+
+            childMin[j] = upper ? center[j] : cellMin[j];
+            childMax[j] = upper ? cellMax[j] : center[j];
+        }
+
+        subdivide(node.children[c], childMin, childMax, octree, binary, byteStride, maxSplats);
+    };
+
+    if (size > parallelSplats)
+    {
+        std::vector<std::future<void>> futures{};
+        for (std::size_t c = 1u; c < node.children.size(); c++)
+        {
+            futures.push_back(std::async(std::launch::async, subdivideChild, c));
+        }
+
+        subdivideChild(0u);
+
+        for (auto& future : futures)
+        {
+            future.get();
+        }
+    }
+    else
+    {
+        for (std::size_t c = 0u; c < node.children.size(); c++)
+        {
+            subdivideChild(c);
+        }
+    }
+
+    for (const auto& child : node.children)
+    {
+        node.height = std::max(node.height, child.height + 1u);
+    }
+
+    // Parent bounds are the union of the children bounds.
+    for (std::uint32_t i = 0u; i < 3u; i++)
+    {
+        node.minPosition[i] = std::numeric_limits<float>::max();
+        node.maxPosition[i] = std::numeric_limits<float>::lowest();
+        node.minBounds[i] = std::numeric_limits<float>::max();
+        node.maxBounds[i] = std::numeric_limits<float>::lowest();
+
+        for (const auto& child : node.children)
+        {
+            node.minPosition[i] = std::min(node.minPosition[i], child.minPosition[i]);
+            node.maxPosition[i] = std::max(node.maxPosition[i], child.maxPosition[i]);
+            node.minBounds[i] = std::min(node.minBounds[i], child.minBounds[i]);
+            node.maxBounds[i] = std::max(node.maxBounds[i], child.maxBounds[i]);
+        }
+    }
+}
+
+Octree buildOctree(const std::string& binary, std::uint32_t count, std::uint32_t byteStride, std::uint32_t maxSplats)
+{
+    Octree octree{};
+
+    octree.indices.resize(count);
+    for (std::uint32_t i = 0u; i < count; i++)
+    {
+        octree.indices[i] = i;
+    }
+
+    octree.root.begin = 0u;
+    octree.root.end = count;
+
+    octree.maxSplats = std::max(maxSplats, 1u);
+
+    // Octree cells are cubes around the position bounds.
+    float minPosition[3];
+    float maxPosition[3];
+    getPositionBounds(binary, count, byteStride, minPosition, maxPosition);
+
+    float size{0.0f};
+    for (std::uint32_t i = 0u; i < 3u; i++)
+    {
+        size = std::max(size, maxPosition[i] - minPosition[i]);
+    }
+
+    float cellMin[3];
+    float cellMax[3];
+    for (std::uint32_t i = 0u; i < 3u; i++)
+    {
+        const float center = 0.5f * (minPosition[i] + maxPosition[i]);
+
+        cellMin[i] = center - 0.5f * size;
+        cellMax[i] = center + 0.5f * size;
+    }
+
+    subdivide(octree.root, cellMin, cellMax, octree, binary, byteStride, octree.maxSplats);
+
+    return octree;
+}
+
+static bool hasContent(const TileNode& node, std::uint32_t lodLevels)
+{
+    return node.children.empty() || node.height <= lodLevels;
+}
+
+// Gathers the nodes having content in depth first order, which is also the order of the tile names.
+static void gatherContent(const TileNode& node, std::uint32_t lodLevels, std::vector<const TileNode*>& contents)
+{
+    if (hasContent(node, lodLevels))
+    {
+        contents.push_back(&node);
+    }
+
+    for (const auto& child : node.children)
+    {
+        gatherContent(child, lodLevels, contents);
+    }
+}
+
+static std::string getTileName(std::size_t index)
+{
+    return "tile_" + std::to_string(index);
+}
+
+static json createTile(const TileNode& node, std::uint32_t lodLevels, const std::vector<float>& geometricErrors, std::size_t& contentIndex)
+{
+    json tile = json::object();
+
+    // 3D Tiles is z-up, where glTF content is y-up and rotated at runtime.
+    float center[3];
+    float halfSize[3];
+    for (std::uint32_t i = 0u; i < 3u; i++)
+    {
+        center[i] = 0.5f * (node.minBounds[i] + node.maxBounds[i]);
+        halfSize[i] = 0.5f * (node.maxBounds[i] - node.minBounds[i]);
+    }
+
+    json box = json::array({center[0u], -center[2u], center[1u], halfSize[0u], 0.0f, 0.0f, 0.0f, halfSize[2u], 0.0f, 0.0f, 0.0f, halfSize[1u]});
+
+    tile["boundingVolume"] = json::object();
+    tile["boundingVolume"]["box"] = box;
+
+    if (hasContent(node, lodLevels))
+    {
+        tile["geometricError"] = geometricErrors[contentIndex];
+        tile["content"] = json::object();
+        tile["content"]["uri"] = getTileName(contentIndex) + ".gltf";
+
+        contentIndex++;
+    }
+    else
+    {
+        tile["geometricError"] = 2.0f * std::sqrt(halfSize[0u] * halfSize[0u] + halfSize[1u] * halfSize[1u] + halfSize[2u] * halfSize[2u]);
+    }
+
+    if (!node.children.empty())
+    {
+        tile["children"] = json::array();
+
+        for (const auto& child : node.children)
+        {
+            tile["children"].push_back(createTile(child, lodLevels, geometricErrors, contentIndex));
+        }
+    }
+
+    return tile;
+}
+
+static bool saveTile(const std::string& binary, std::uint32_t count, std::uint32_t degree, const std::string& directory, const std::string& name)
+{
+    json glTF = createGltf(name + ".bin", binary, count, degree);
+
+    if (!saveFile(binary, directory + "/" + name + ".bin") || !saveFile(glTF.dump(3), directory + "/" + name + ".gltf"))
+    {
+        printf("Error: Could not save tile '%s'\n", name.c_str());
+
+        return false;
+    }
+
+    return true;
+}
+
+bool saveTiles(const Octree& octree, const std::string& binary, std::uint32_t degree, std::uint32_t lodLevels, const std::string& directory)
+{
+    const std::uint32_t byteStride = getByteStride(degree);
+
+    std::error_code errorCode{};
+    std::filesystem::create_directories(directory, errorCode);
+    if (errorCode)
+    {
+        printf("Error: Could not create directory '%s'\n", directory.c_str());
+
+        return false;
+    }
+
+    std::vector<const TileNode*> contents{};
+    gatherContent(octree.root, lodLevels, contents);
+
+    std::vector<float> geometricErrors(contents.size(), 0.0f);
+
+    std::atomic<bool> success{true};
+
+    // Inner nodes are merging in parallel on their own, so only the leaves are distributed over threads.
+    for (std::size_t contentIndex = 0u; contentIndex < contents.size(); contentIndex++)
+    {
+        const TileNode& node = *contents[contentIndex];
+        if (node.children.empty())
+        {
+            continue;
+        }
+
+        MergedSplats merged = mergeSplats(binary, octree.indices.data() + node.begin, node.end - node.begin, degree, octree.maxSplats);
+
+        geometricErrors[contentIndex] = merged.cellSize;
+
+        if (!saveTile(merged.binary, merged.count, degree, directory, getTileName(contentIndex)))
+        {
+            return false;
+        }
+    }
+
+    parallelFor(0u, contents.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t contentIndex = begin; contentIndex < end; contentIndex++)
+        {
+            const TileNode& leaf = *contents[contentIndex];
+            if (!leaf.children.empty())
+            {
+                continue;
+            }
+
+            const std::uint32_t count = leaf.end - leaf.begin;
+
+            std::string tileBinary(static_cast<std::size_t>(byteStride) * count, 0);
+            for (std::uint32_t i = 0u; i < count; i++)
+            {
+                std::memcpy(tileBinary.data() + static_cast<std::size_t>(byteStride) * i, binary.data() + static_cast<std::size_t>(byteStride) * octree.indices[leaf.begin + i], byteStride);
+            }
+
+            if (!saveTile(tileBinary, count, degree, directory, getTileName(contentIndex)))
+            {
+                success = false;
+            }
+        }
+    });
+
+    if (!success)
+    {
+        return false;
+    }
+
+    //
+
+    json tileset = json::object();
+
+    tileset["asset"] = json::object();
+    tileset["asset"]["version"] = "1.1";
+    tileset["asset"]["generator"] = "3DGS PLY to glTF converter by Huawei";
+
+    std::size_t contentIndex{0u};
+    tileset["root"] = createTile(octree.root, lodLevels, geometricErrors, contentIndex);
+    // Coarser levels of detail are replaced by their children, otherwise only the leaves are having content.
+    tileset["root"]["refine"] = lodLevels > 0u ? "REPLACE" : "ADD";
+
+    tileset["geometricError"] = tileset["root"]["geometricError"];
+    if (lodLevels > 0u)
+    {
+        // Root content should be rendered at least from distance.
+        float halfSize[3];
+        for (std::uint32_t i = 0u; i < 3u; i++)
+        {
+            halfSize[i] = 0.5f * (octree.root.maxBounds[i] - octree.root.minBounds[i]);
+        }
+
+        tileset["geometricError"] = 2.0f * std::sqrt(halfSize[0u] * halfSize[0u] + halfSize[1u] * halfSize[1u] + halfSize[2u] * halfSize[2u]);
+    }
+
+    if (!saveFile(tileset.dump(3), directory + "/tileset.json"))
+    {
+        printf("Error: Could not save '%s/tileset.json'\n", directory.c_str());
+
+        return false;
+    }
+
+    printf("Info: Saved %zu tiles to '%s'\n", contents.size(), directory.c_str());
+
+    return true;
+}
@@ -0,0 +1,47 @@
+#ifndef GLTF_TILE_H
+#define GLTF_TILE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct TileNode
+{
+    // Tight bounds of the splat positions, as stored in the POSITION accessor.
+    float minPosition[3];
+    float maxPosition[3];
+
+    // Bounds enlarged by the splat extent, as used for the bounding volume.
+    float minBounds[3];
+    float maxBounds[3];
+
+    // Range of the splats in the octree indices.
+    std::uint32_t begin{0u};
+    std::uint32_t end{0u};
+
+    std::uint32_t depth{0u};
+
+    // Levels of children below this node, zero for leaves.
+    std::uint32_t height{0u};
+
+    std::vector<TileNode> children{};
+};
+
+struct Octree
+{
+    // Splat indices sorted, that every node covers a contiguous range.
+    std::vector<std::uint32_t> indices{};
+
+    TileNode root{};
+
+    std::uint32_t maxSplats{0u};
+};
+
+// Partitions the splats in parallel until a node contains not more than maxSplats.
+Octree buildOctree(const std::string& binary, std::uint32_t count, std::uint32_t byteStride, std::uint32_t maxSplats);
+
+// Writes one glTF per leaf node and a 3D Tiles tileset.json referencing them into the given directory.
+// Inner nodes up to lodLevels above the leaves get merged splats as coarser level of detail.
+bool saveTiles(const Octree& octree, const std::string& binary, std::uint32_t degree, std::uint32_t lodLevels, const std::string& directory);
+
+#endif /*GLTF_TILE_H*/